@@ -0,0 +1,114 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define MIN_BLOCK_SZ    (64 * 1024)
+
+struct arena_block {
+        struct arena_block *next;
+        size_t cap;
+        size_t used;
+        alignas(max_align_t) char data[];
+};
+
+static pthread_key_t local_key;
+static pthread_once_t local_once = PTHREAD_ONCE_INIT;
+
+static struct arena_block *block_new(size_t cap);
+static void local_key_init(void);
+static void local_destroy(void *arena);
+
+void arena_init(struct arena *arena) {
+        *arena = (struct arena){.first = NULL,
+                                .cur = NULL};
+}
+void arena_destroy(struct arena *arena) {
+        struct arena_block *block = arena->first;
+        while (block != NULL) {
+                struct arena_block *next = block->next;
+                free(block);
+                block = next;
+        }
+        arena_init(arena);
+}
+void *arena_alloc(struct arena *arena,
+                  size_t sz) {
+        const size_t align = alignof(max_align_t);
+        sz = (sz + align - 1) & ~(align - 1);
+
+        struct arena_block *block = arena->cur;
+        if ((block != NULL) && (block->cap - block->used >= sz)) {
+                void *ptr = block->data + block->used;
+                block->used += sz;
+                return ptr;
+        }
+
+        /* move on to the next block, dropping spares too small to hold sz */
+        struct arena_block **link = (block == NULL)
+                                    ? &arena->first
+                                    : &block->next;
+        while ((*link != NULL) && ((*link)->cap < sz)) {
+                struct arena_block *small = *link;
+                *link = small->next;
+                free(small);
+        }
+        if (*link == NULL) {
+                size_t cap = (block == NULL) ? MIN_BLOCK_SZ : block->cap * 2;
+                if (cap < sz) {
+                        cap = sz;
+                }
+                *link = block_new(cap);
+        }
+        arena->cur = *link;
+        arena->cur->used = sz;
+        return arena->cur->data;
+}
+struct arena_mark arena_mark(const struct arena *arena) {
+        return (struct arena_mark){.block = arena->cur,
+                                   .used = (arena->cur == NULL)
+                                           ? 0
+                                           : arena->cur->used};
+}
+void arena_release(struct arena *arena,
+                   struct arena_mark mark) {
+        arena->cur = mark.block;
+        if (arena->cur != NULL) {
+                arena->cur->used = mark.used;
+        }
+}
+
+struct arena *arena_local(void) {
+        pthread_once(&local_once, local_key_init);
+        struct arena *arena = pthread_getspecific(local_key);
+        if (arena == NULL) {
+                arena = malloc(sizeof(*arena));
+                if (arena == NULL) {
+                        abort();
+                }
+                arena_init(arena);
+                pthread_setspecific(local_key, arena);
+        }
+        return arena;
+}
+
+static struct arena_block *block_new(size_t cap) {
+        struct arena_block *block = malloc(sizeof(*block) + cap);
+        if (block == NULL) {
+                abort();
+        }
+        *block = (struct arena_block){.next = NULL,
+                                      .cap = cap,
+                                      .used = 0};
+        return block;
+}
+static void local_key_init(void) {
+        if (pthread_key_create(&local_key, local_destroy) != 0) {
+                abort();
+        }
+}
+static void local_destroy(void *arena) {
+        arena_destroy(arena);
+        free(arena);
+}
@@ -0,0 +1,33 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator over a chain of blocks. Memory is only given back in bulk
+ * by releasing to an earlier mark; released blocks stay in the chain and
+ * are reused, so a steady workload stops calling malloc altogether. */
+struct arena_block;
+struct arena {
+        struct arena_block *first;
+        struct arena_block *cur;
+};
+struct arena_mark {
+        struct arena_block *block;
+        size_t used;
+};
+
+void arena_init(struct arena *arena);
+void arena_destroy(struct arena *arena);
+/** Never returns NULL; aborts if the system is out of memory */
+void *arena_alloc(struct arena *arena,
+                  size_t sz);
+struct arena_mark arena_mark(const struct arena *arena);
+/** Frees everything allocated since mark was taken */
+void arena_release(struct arena *arena,
+                   struct arena_mark mark);
+
+/** The calling thread's scratch arena; callers must release what they
+ * take before returning */
+struct arena *arena_local(void);
+
+#endif /* !ARENA_H */
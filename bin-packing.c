@@ -1,14 +1,29 @@
 #include "bin-packing.h"
 #include "chromosome.h"
+#include "rng.h"
+#include "int-inst.h"
+#include "migrant-ring.h"
+#include "case-store.h"
+#include "lower-bound.h"
 #include <assert.h>
 #include <stdlib.h>
-#include "parallel-foreach.h"
 #include <time.h>
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
-static FILE *CASE_INJECT_FILE = NULL;
+/* the case store of runs not given one, for the life of the process */
+static struct case_store DEFAULT_CASES;
+static pthread_once_t DEFAULT_CASES_ONCE = PTHREAD_ONCE_INIT;
+/* held shared by every run, and exclusively by one forking its islands,
+ * so that no other run holds a lock the children would inherit */
+static pthread_rwlock_t RUNS_LOCK = PTHREAD_RWLOCK_INITIALIZER;
 
 #define POP_I(POP, I) \
         (*(struct chromosome *)((POP).chroms \
@@ -22,24 +37,82 @@ struct population {
         double bin_cap;
         const double *prob_inst;
         size_t inst_sz;
+        /* random draws are keyed by seed, generation, phase and element so
+         * a run repeats exactly whichever thread handles each element */
+        uint64_t seed;
+        uint64_t epoch;
+        /* NULL when caching is off */
+        struct fitness_cache *cache;
+        /* the fittest num_elites chromosomes survive each generation
+         * untouched by crossover and mutation; they sit at the front */
+        size_t num_elites;
+        /* bred by the grouping operators rather than OX and swaps */
+        bool is_grouping;
+};
+enum rng_phase {
+        RNG_INIT,
+        RNG_SELECT,
+        RNG_CX,
+        RNG_MUT,
+        RNG_SEARCH
 };
 
-static double sum_inst(const double *prob_inst, size_t inst_sz);
+/* genetic_algorithm, or grouping_genetic_algorithm if is_grouping */
+static struct solution ga_solve(bool is_grouping,
+                                const double *prob_inst,
+                                size_t inst_sz,
+                                double bin_cap,
+                                size_t lower_bound,
+                                size_t known_optimum,
+                                bool use_case_injection,
+                                enum init_type init,
+                                bool use_local_search,
+                                enum search_type search,
+                                enum search_adaptation_type adapt,
+                                int max_threads,
+                                int max_generations,
+                                double max_time,
+                                FILE *out,
+                                const struct ga_tuning *tuning,
+                                struct ga_stats *stats);
+static void default_cases_open(void);
+static void pop_rng_seed(struct population pop,
+                         enum rng_phase phase,
+                         size_t index);
+static size_t pop_index(struct population pop,
+                        const void *elem);
+/* the best lower bound on the bins that can be computed for prob_inst */
+static size_t inst_lower_bound(const double *prob_inst,
+                               size_t inst_sz,
+                               double bin_cap);
 static double time_elapsed(const struct timespec *time_start);
+static void print_gen(FILE *out,
+                      struct population pop,
+                      int num_gens,
+                      double elapsed,
+                      int best_num_bins,
+                      double best_fitness,
+                      double avg_fitness,
+                      int num_searches);
 struct foreach_init_context {
         const bool is_baldwinian;
         const size_t perm_sz;
 };
 static int pop_init_foreach_init(void *elem,
                                  void *context);
+/* allocates pop->chroms with every chromosome initialized and owning a
+ * perm; the storage is recycled from generation to generation */
+static void pop_alloc(struct population *pop,
+                      int max_threads);
+static void pop_free(struct population pop);
 static void pop_init_mut(struct chromosome *chrom,
                          size_t inst_sz);
 /* returns number of searches conducted, if any */
 static int pop_init(struct population pop,
                     enum init_type init,
                     chrom_search_func search_func,
-                    bool use_case_injection,
-                    int max_threads);
+                    struct case_store *cases,
+                    size_t case_k);
 struct eval_foreach_context {
         const struct population pop;
 };
@@ -47,8 +120,14 @@ static int pop_eval_foreach(void *elem,
                             void *eval_foreach_context);
 static void pop_eval(struct population pop,
                      int max_threads);
+static int pop_decode_foreach(void *elem,
+                              void *eval_foreach_context);
+/* decodes every chromosome whose solution was left empty */
+static void pop_decode(struct population pop,
+                       int max_threads);
 struct select_foreach_context {
         const struct population pop;
+        const size_t *tourn;
 };
 static int tournament_select_foreach(void *elem,
                                      void *select_foreach_context);
@@ -56,20 +135,33 @@ struct cx_foreach_context {
         const struct population pop;
         const size_t *tourn;
         const size_t tourn_count;
+        const struct population children;
 };
 static int pop_cx_foreach(void *elem,
                           void *cx_foreach_context);
+/* storage for pop_cx, allocated once per run */
+struct cx_scratch {
+        /* pop_sz tournament winners */
+        size_t *tourn;
+        /* num_elites indices, fittest first */
+        size_t *elites;
+};
+/* fills children, a second buffer of the same shape as pop, from pop;
+ * the elites are moved rather than copied, leaving their old slots in
+ * pop as spare storage */
 static void pop_cx(struct population pop,
-                   struct population *children,
+                   struct population children,
+                   struct cx_scratch scratch,
                    int max_threads);
-static void pop_replace(struct population pop,
-                        struct population children,
-                        int max_threads);
-static void destroy_children(struct population *children,
-                             int max_threads);
+static void pop_top(struct population pop,
+                    size_t *top,
+                    size_t k);
+static void chrom_swap(struct population pop,
+                       void *a,
+                       void *b);
 struct mut_foreach_context {
+        const struct population pop;
         const double mut_rate;
-        const size_t inst_sz;
 };
 static int pop_mut_foreach(void *elem,
                            void *mut_foreach_context);
@@ -79,37 +171,184 @@ static void pop_mut(struct population pop,
 struct search_foreach_context {
         const struct population pop;
         const chrom_search_func search_func;
-        int num_searches;
-        volatile bool is_locked;
 };
+/* the accumulator is an int count of searches */
 static int pop_search_foreach(void *elem,
+                              void *num_searches,
                               void *search_foreach_context);
 /* returns number of searches conducted, if any */
 static int pop_search(struct population pop,
                       chrom_search_func search_func,
+                      const struct ga_tuning *tuning,
                       int max_threads);
-struct avg_fitness_foreach_context {
-        double sum_fitness;
-        volatile bool is_locked;
-};
+/* reducers for counting searches and summing fitnesses */
+static void int_zero(void *acc,
+                     void *unused);
+static void int_add(void *dest,
+                    const void *src,
+                    void *unused);
+static void double_zero(void *acc,
+                        void *unused);
+static void double_add(void *dest,
+                       const void *src,
+                       void *unused);
 static int pop_avg_fitness_foreach(void *elem,
-                                   void *avg_fitness_foreach_context);
+                                   void *sum_fitness,
+                                   void *unused);
 static double pop_avg_fitness(const struct population pop,
                               int max_threads);
-struct fitness_foreach_context {
+struct best_fitness_acc {
         double best_fitness;
         struct chromosome *best_chrom;
-        volatile bool is_locked;
 };
+static void best_fitness_init(void *acc,
+                              void *unused);
+/* the fitter chromosome wins, the earlier one on ties */
+static void best_fitness_combine(void *dest,
+                                 const void *src,
+                                 void *unused);
 static int pop_best_fitness_foreach(void *elem,
-                                    void *fitness_foreach_context);
+                                    void *best_fitness_acc,
+                                    void *unused);
 static double pop_best_fitness(const struct population pop,
                                struct solution *best_sol_copy,
                                int max_threads);
+static struct chromosome *pop_worst(struct population pop);
+
+/* a population with what it takes to breed it; a run is a single island
+ * unless ga_tuning.islands asks for more */
+struct island {
+        struct ga_run *run;
+        /* children are bred into next, then the two swap roles */
+        struct population pop;
+        struct population next;
+        struct cx_scratch scratch;
+        int max_threads;
+        int num_gens;
+        int num_searches;
+        double best_fitness;
+        double avg_fitness;
+        struct solution best_sol;
+        /* the fewest bins best_sol has had, and when it first had them */
+        int fewest_bins;
+        double fewest_bins_time;
+        /* migrants leave on out and arrive on in; NULL without migration */
+        struct migrant_ring *out;
+        struct migrant_ring *in;
+        /* the fittest ga_tuning.migrants indices, and a spare perm that
+         * takes in an arrival */
+        size_t *emigrants;
+        size_t *arrival;
+        /* the latest generation's figures, on the board */
+        struct island_shown *shown;
+};
+/* what an island publishes for island 0 to report */
+struct island_shown {
+        _Alignas(64) _Atomic double best_fitness;
+        _Atomic double avg_fitness;
+        atomic_int best_num_bins;
+        atomic_int num_searches;
+        atomic_int num_gens;
+        atomic_int fewest_bins;
+        _Atomic double fewest_bins_time;
+};
+/* What islands tell one another, in a single block that is mapped shared
+ * before any fork when islands are processes. The block holds the board,
+ * num_islands shown figures, the migrant rings and, for processes, the
+ * perm of each island's best packing as it ends. It lives at the same
+ * address in every process, so the pointers into it hold everywhere. */
+struct island_board {
+        size_t size;
+        bool is_shared;
+        /* raised once an island reaches stop_bins */
+        atomic_bool is_done;
+        struct island_shown *shown;
+        /* num_islands rings, each ring_size bytes; none if ring_size is 0 */
+        unsigned char *rings;
+        size_t ring_size;
+        /* num_islands perms of inst_sz; NULL unless is_shared */
+        size_t *best_perms;
+};
+/* what the islands of a run share */
+struct ga_run {
+        const struct ga_tuning *tuning;
+        chrom_search_func search_func;
+        bool use_local_search;
+        double mut_rate;
+        int max_generations;
+        double max_time;
+        struct timespec time_start;
+        size_t start_decodes;
+        int theoretical_min_bins;
+        /* a packing of this few bins is optimal and ends the run: the
+         * lower bound, or the known optimum if larger */
+        int stop_bins;
+        FILE *out;
+        struct island *islands;
+        size_t num_islands;
+        struct island_board *board;
+};
+static void island_alloc(struct island *isl,
+                         struct ga_run *run,
+                         struct population proto,
+                         int max_threads);
+static void island_free(struct island *isl);
+/* breeds generation 1 */
+static void island_start(struct island *isl,
+                         enum init_type init,
+                         struct case_store *cases);
+static bool island_is_running(const struct island *isl);
+static void island_step(struct island *isl);
+/* notes when best_sol reaches fewer bins than before, and ends the run
+ * once it reaches stop_bins */
+static void island_track_best(struct island *isl);
+/* sends copies of the fittest to the next island and lets arrivals from
+ * the previous one replace the least fit, if fitter */
+static void island_migrate(struct island *isl);
+/* publishes the figures of the generation just bred for island 0 */
+static void island_publish(struct island *isl);
+/* island_publish; island 0 also prints the figures of the whole run */
+static void island_report(struct island *isl);
+/* the generation loop; a pthread start routine */
+static void *island_main(void *island);
+/* ring_cap migrants per ring, or no rings if 0 */
+static struct island_board *board_alloc(size_t num_islands,
+                                        size_t ring_cap,
+                                        size_t inst_sz,
+                                        bool is_shared);
+static void board_free(struct island_board *board);
+/* runs islands 1 and up on threads of their own and island 0 on this
+ * one */
+static void islands_run_threads(struct ga_run *run);
+/* runs every island in a child process and waits for them all; this
+ * process then decodes each island's best from the board. An island
+ * whose process could not run or failed keeps its generation 1 */
+static void islands_run_procs(struct ga_run *run);
+/* from what the islands last published */
+static void run_stats(const struct ga_run *run,
+                      struct ga_stats *stats);
+
+void ga_tuning_init(struct ga_tuning *tuning) {
+        *tuning = (struct ga_tuning){.search_sched = PARA_DYNAMIC,
+                                     .search_grain = 1,
+                                     .seed = 1,
+                                     .decoder = FIRST_FIT_LINEAR,
+                                     .int_sizes = true,
+                                     .cache_bits = 16,
+                                     .elites = 1,
+                                     .islands = 1,
+                                     .migration_interval = 10,
+                                     .migrants = 2,
+                                     .island_procs = false,
+                                     .case_store = NULL,
+                                     .case_k = 100};
+}
 
 struct solution genetic_algorithm(const double *prob_inst,
                                   size_t inst_sz,
                                   double bin_cap,
+                                  size_t lower_bound,
+                                  size_t known_optimum,
                                   bool use_case_injection,
                                   enum init_type init,
                                   bool use_local_search,
@@ -118,124 +357,275 @@ struct solution genetic_algorithm(const double *prob_inst,
                                   int max_threads,
                                   int max_generations,
                                   double max_time,
-                                  FILE *out) {
+                                  FILE *out,
+                                  const struct ga_tuning *tuning,
+                                  struct ga_stats *stats) {
+        return ga_solve(false, prob_inst, inst_sz, bin_cap, lower_bound,
+                        known_optimum, use_case_injection, init,
+                        use_local_search, search, adapt, max_threads,
+                        max_generations, max_time, out, tuning, stats);
+}
+struct solution grouping_genetic_algorithm(const double *prob_inst,
+                                           size_t inst_sz,
+                                           double bin_cap,
+                                           size_t lower_bound,
+                                           size_t known_optimum,
+                                           bool use_case_injection,
+                                           enum init_type init,
+                                           bool use_local_search,
+                                           enum search_type search,
+                                           enum search_adaptation_type adapt,
+                                           int max_threads,
+                                           int max_generations,
+                                           double max_time,
+                                           FILE *out,
+                                           const struct ga_tuning *tuning,
+                                           struct ga_stats *stats) {
+        return ga_solve(true, prob_inst, inst_sz, bin_cap, lower_bound,
+                        known_optimum, use_case_injection, init,
+                        use_local_search, search, adapt, max_threads,
+                        max_generations, max_time, out, tuning, stats);
+}
+
+static struct solution ga_solve(bool is_grouping,
+                                const double *prob_inst,
+                                size_t inst_sz,
+                                double bin_cap,
+                                size_t lower_bound,
+                                size_t known_optimum,
+                                bool use_case_injection,
+                                enum init_type init,
+                                bool use_local_search,
+                                enum search_type search,
+                                enum search_adaptation_type adapt,
+                                int max_threads,
+                                int max_generations,
+                                double max_time,
+                                FILE *out,
+                                const struct ga_tuning *tuning,
+                                struct ga_stats *stats) {
         if (!use_local_search && (adapt == BALDWINIAN)) {
                 assert(false);
         }
+        struct ga_tuning default_tuning;
+        if (tuning == NULL) {
+                ga_tuning_init(&default_tuning);
+                tuning = &default_tuning;
+        }
         const int pop_sz = 100;
-        const double mut_rate = 0.1;
-        struct timespec time_start;
-        clock_gettime(CLOCK_REALTIME, &time_start);
-        const int theoretical_min_bins = sum_inst(prob_inst, inst_sz)
-                                         / bin_cap;
-        int num_searches;
-        int num_gens = 1;
-        double best_fitness;
-        double avg_fitness;
-        struct solution best_sol;
+        struct ga_run run = {.tuning = tuning,
+                             .use_local_search = use_local_search,
+                             .mut_rate = 0.1,
+                             .max_generations = max_generations,
+                             .max_time = max_time,
+                             .out = out,
+                             .num_islands = (tuning->islands > 1)
+                                            ? tuning->islands : 1};
+        /* see ga_tuning.island_procs */
+        const bool use_procs = (run.num_islands > 1) && tuning->island_procs
+                               && (pthread_rwlock_trywrlock(&RUNS_LOCK)
+                                   == 0);
+        if (!use_procs) {
+                pthread_rwlock_rdlock(&RUNS_LOCK);
+        }
+        clock_gettime(CLOCK_REALTIME, &run.time_start);
+        run.start_decodes = solution_first_fit_count();
 
-        chrom_search_func search_func;
         switch (search) {
                 case NONE:
-                        search_func = NULL;
+                        run.search_func = NULL;
                         break;
                 case SWAP_RAND:
-                        search_func = chrom_search_swap;
+                        run.search_func = chrom_search_swap;
                         break;
                 case SHUFFLE_GROUPS:
-                        search_func = chrom_search_shuffle;
+                        run.search_func = chrom_search_shuffle;
                         break;
                 case DOMINANCE:
-                        search_func = chrom_search_dom;
+                        run.search_func = chrom_search_dom;
                         break;
                 default:
                         assert(false);
         }
 
-        struct population pop;
-        pop.pop_sz = pop_sz;
-        pop.bin_cap = bin_cap;
-        pop.prob_inst = prob_inst;
-        pop.inst_sz = inst_sz;
+        /* the islands' populations start as copies of this one */
+        struct population pop = {.chroms = NULL,
+                                 .pop_sz = pop_sz,
+                                 .bin_cap = bin_cap,
+                                 .prob_inst = prob_inst,
+                                 .inst_sz = inst_sz,
+                                 .seed = tuning->seed,
+                                 .epoch = 0,
+                                 .cache = NULL,
+                                 .is_grouping = is_grouping};
+        struct fitness_cache cache;
+        if (tuning->cache_bits > 0) {
+                fitness_cache_init(&cache, tuning->cache_bits);
+                pop.cache = &cache;
+        }
+        solution_first_fit_select(tuning->decoder);
+        const bool is_int_inst = tuning->int_sizes
+                                 && int_inst_register(prob_inst, inst_sz,
+                                                      bin_cap);
+        if (lower_bound == 0) {
+                lower_bound = inst_lower_bound(prob_inst, inst_sz, bin_cap);
+        }
+        if (known_optimum < lower_bound) {
+                known_optimum = lower_bound;
+        }
+        /* no packing has more bins than items, so INT_MAX is never met */
+        run.theoretical_min_bins = (lower_bound < INT_MAX)
+                                   ? (int)lower_bound : INT_MAX;
+        run.stop_bins = (known_optimum < INT_MAX) ? (int)known_optimum
+                                                  : INT_MAX;
         switch (adapt) {
                 case LAMARCKIAN:
-                        pop.chroms = malloc(pop_sz
-                                            * sizeof(struct chromosome));
                         pop.is_baldwinian = false;
                         break;
                 case BALDWINIAN:
-                        pop.chroms = malloc(pop_sz
-                                            * sizeof(struct bald_chrom));
                         pop.is_baldwinian = true;
                         break;
                 default:
                         assert(false);
         }
-        if (pop.chroms == NULL) {
-                abort();
+        pop.num_elites = tuning->elites;
+        if (pop.num_elites >= pop_sz) {
+                pop.num_elites = pop_sz - 1;
         }
 
-        num_searches = pop_init(pop, init, search_func,
-                                use_case_injection, max_threads);
-        pop_eval(pop, max_threads);
-        solution_init(&best_sol);
-        best_fitness = pop_best_fitness(pop, &best_sol, max_threads);
-        avg_fitness = pop_avg_fitness(pop, max_threads);
+        run.islands = malloc(run.num_islands * sizeof(*run.islands));
+        if (run.islands == NULL) {
+                abort();
+        }
+        for (size_t i = 0; i < run.num_islands; i++) {
+                /* island 0 draws what a run without islands would */
+                pop.seed = (i == 0) ? tuning->seed : rng_mix(tuning->seed, i);
+                island_alloc(&run.islands[i], &run, pop, max_threads);
+        }
+        size_t ring_cap = 0;
+        if ((run.num_islands > 1) && (tuning->migration_interval > 0)
+            && (tuning->migrants > 0)) {
+                ring_cap = 1;
+                while (ring_cap < 2 * tuning->migrants) {
+                        ring_cap *= 2;
+                }
+        }
+        run.board = board_alloc(run.num_islands, ring_cap, inst_sz,
+                                use_procs);
+        for (size_t i = 0; i < run.num_islands; i++) {
+                run.islands[i].shown = &run.board->shown[i];
+                if (ring_cap == 0) {
+                        continue;
+                }
+                /* ring i carries migrants from island i to island i + 1 */
+                struct migrant_ring *ring = (struct migrant_ring *)
+                        (run.board->rings + i * run.board->ring_size);
+                run.islands[i].out = ring;
+                run.islands[(i + 1) % run.num_islands].in = ring;
+        }
 
+        struct case_store *cases = NULL;
+        if (use_case_injection) {
+                cases = tuning->case_store;
+                if (cases == NULL) {
+                        pthread_once(&DEFAULT_CASES_ONCE, default_cases_open);
+                        cases = &DEFAULT_CASES;
+                }
+        }
+        /* generation 1 is bred here, one island at a time, before any
+         * island runs on a thread or in a process of its own */
+        for (size_t i = 0; i < run.num_islands; i++) {
+                island_start(&run.islands[i], init, cases);
+        }
         fprintf(out, "theoretical minimum bins: %d\n"
-               "gen\tcum time\tbes bin\tbest fit\tavrg fit\tsearches\n",
-               theoretical_min_bins);
-        fprintf(out, "%d\t%lf\t%d\t%lf\t%lf\t%d\n",
-               num_gens, time_elapsed(&time_start), best_sol.num_bins,
-               best_fitness, avg_fitness, num_searches);
-
-        num_gens++;
+               "gen\tcum time\tbes bin\tbest fit\tavrg fit\tsearches"
+               "\tc. hits\tc. misses\n",
+               run.theoretical_min_bins);
+        island_report(&run.islands[0]);
 
-        while ((num_gens <= max_generations)
-               && (time_elapsed(&time_start) <= max_time)
-               && (best_sol.num_bins > theoretical_min_bins)) {
-                struct population children;
-                pop_cx(pop, &children, max_threads);
-                pop_replace(pop, children, max_threads);
-                destroy_children(&children, max_threads);
+        if (run.num_islands == 1) {
+                island_main(&run.islands[0]);
+        } else if (run.board->is_shared) {
+                islands_run_procs(&run);
+        } else {
+                islands_run_threads(&run);
+        }
 
-                if (!use_local_search) {
-                        pop_mut(pop, mut_rate, max_threads);
-                } else {
-                        num_searches += pop_search(pop, search_func,
-                                                   max_threads);
+        if (stats != NULL) {
+                run_stats(&run, stats);
+        }
+        /* the fittest island's best, the earliest island on ties */
+        size_t best = 0;
+        for (size_t i = 1; i < run.num_islands; i++) {
+                if (run.islands[i].best_fitness
+                    > run.islands[best].best_fitness) {
+                        best = i;
                 }
-
-                pop_eval(pop, max_threads);
-                solution_destroy(best_sol);
-                best_fitness = pop_best_fitness(pop, &best_sol, max_threads);
-                avg_fitness = pop_avg_fitness(pop, max_threads);
-                fprintf(out, "%d\t%lf\t%d\t%lf\t%lf\t%d\n",
-                       num_gens, time_elapsed(&time_start), best_sol.num_bins,
-                       best_fitness, avg_fitness, num_searches);
-
-                num_gens++;
         }
-
-        for (size_t i = 0; i < pop_sz; i++) {
-                chrom_destroy(&POP_I(pop, i), pop.is_baldwinian);
+        struct solution best_sol = run.islands[best].best_sol;
+        solution_init(&run.islands[best].best_sol);
+        for (size_t i = 0; i < run.num_islands; i++) {
+                island_free(&run.islands[i]);
         }
-        free(pop.chroms);
-        if (use_case_injection) {
+        free(run.islands);
+        board_free(run.board);
+        if (pop.cache != NULL) {
+                fitness_cache_destroy(pop.cache);
+        }
+        if (is_int_inst) {
+                int_inst_unregister(prob_inst);
+        }
+        if (cases != NULL) {
                 size_t *buf = solution_reverse_first_fit(best_sol, inst_sz);
-                fseek(CASE_INJECT_FILE, 0, SEEK_END);
-                fwrite(buf, sizeof(*buf), inst_sz, CASE_INJECT_FILE);
+                case_store_add(cases, prob_inst, inst_sz, bin_cap, buf,
+                               best_sol.num_bins);
                 free(buf);
         }
+        pthread_rwlock_unlock(&RUNS_LOCK);
         return best_sol;
 }
-
-static double sum_inst(const double *prob_inst, size_t inst_sz) {
-        double sum = 0.0;
-        for (size_t i = 0; i < inst_sz; i++) {
-                sum += prob_inst[i];
+static void default_cases_open(void) {
+        case_store_open(&DEFAULT_CASES, NULL);
+}
+static void pop_rng_seed(struct population pop,
+                         enum rng_phase phase,
+                         size_t index) {
+        rng_seed_key(pop.seed,
+                     rng_mix(rng_mix(pop.epoch, phase), index));
+}
+/* index of elem within pop.chroms */
+static size_t pop_index(struct population pop,
+                        const void *elem) {
+        const size_t chrom_size = (pop.is_baldwinian)
+                                  ? sizeof(struct bald_chrom)
+                                  : sizeof(struct chromosome);
+        return ((const char *)elem - (const char *)pop.chroms) / chrom_size;
+}
+static size_t inst_lower_bound(const double *prob_inst,
+                               size_t inst_sz,
+                               double bin_cap) {
+        /* the run's own integer form if it registered one */
+        const struct int_inst *ii = int_inst_find(prob_inst, inst_sz,
+                                                  bin_cap);
+        struct int_inst own;
+        if (ii == NULL) {
+                if (!int_inst_init(&own, prob_inst, inst_sz, bin_cap)) {
+                        return lower_bound_l1_double(prob_inst, inst_sz,
+                                                     bin_cap);
+                }
+                ii = &own;
+        }
+        uint32_t *by_size = malloc(inst_sz * sizeof(*by_size));
+        if ((by_size == NULL) && (inst_sz > 0)) {
+                abort();
         }
-        return sum;
+        lower_bound_order(prob_inst, inst_sz, by_size);
+        const size_t bound = lower_bound_best(ii, by_size);
+        free(by_size);
+        if (ii == &own) {
+                int_inst_destroy(own);
+        }
+        return bound;
 }
 static double time_elapsed(const struct timespec *time_start) {
         struct timespec new_time;
@@ -245,6 +635,23 @@ static double time_elapsed(const struct timespec *time_start) {
         nsec /= 1000000000;
         return sec + nsec;
 }
+static void print_gen(FILE *out,
+                      struct population pop,
+                      int num_gens,
+                      double elapsed,
+                      int best_num_bins,
+                      double best_fitness,
+                      double avg_fitness,
+                      int num_searches) {
+        size_t hits = 0;
+        size_t misses = 0;
+        if (pop.cache != NULL) {
+                fitness_cache_stats_take(pop.cache, &hits, &misses);
+        }
+        fprintf(out, "%d\t%lf\t%d\t%lf\t%lf\t%d\t%zu\t%zu\n",
+                num_gens, elapsed, best_num_bins, best_fitness, avg_fitness,
+                num_searches, hits, misses);
+}
 static int pop_init_foreach_init(void *elem,
                                  void *context) {
         struct foreach_init_context *con = context;
@@ -256,10 +663,30 @@ static int pop_init_foreach_init(void *elem,
         }
         return 0;
 }
+static void pop_alloc(struct population *pop,
+                      int max_threads) {
+        const size_t chrom_size = (pop->is_baldwinian)
+                                  ? sizeof(struct bald_chrom)
+                                  : sizeof(struct chromosome);
+        pop->chroms = malloc(pop->pop_sz * chrom_size);
+        if (pop->chroms == NULL) {
+                abort();
+        }
+        struct foreach_init_context tmp = {.is_baldwinian = pop->is_baldwinian,
+                                           .perm_sz = pop->inst_sz};
+        parallel_foreach(max_threads, pop->chroms, pop->pop_sz, chrom_size,
+                         &tmp, pop_init_foreach_init);
+}
+static void pop_free(struct population pop) {
+        for (size_t i = 0; i < pop.pop_sz; i++) {
+                chrom_destroy(&POP_I(pop, i), pop.is_baldwinian);
+        }
+        free(pop.chroms);
+}
 static void pop_init_mut(struct chromosome *chrom,
                          size_t inst_sz) {
         const int max_muts = 20;
-        const int num_muts = (rand() % max_muts) + 1;
+        const int num_muts = rng_bounded(max_muts) + 1;
         for (int i = 0; i < num_muts; i++) {
                 chrom_mut(chrom, inst_sz);
         }
@@ -268,43 +695,26 @@ static void pop_init_mut(struct chromosome *chrom,
 static int pop_init(struct population pop,
                     enum init_type init,
                     chrom_search_func search_func,
-                    bool use_case_injection,
-                    int max_threads) {
-        const size_t chrom_size = (pop.is_baldwinian)
-                                  ? sizeof(struct bald_chrom)
-                                  : sizeof(struct chromosome);
-        /* initialize all the chromosomes */
-        struct foreach_init_context tmp1 = {.is_baldwinian = pop.is_baldwinian,
-                                            .perm_sz = pop.inst_sz};
-        parallel_foreach(max_threads, pop.chroms, pop.pop_sz, chrom_size,
-                         &tmp1, pop_init_foreach_init);
+                    struct case_store *cases,
+                    size_t case_k) {
+        /* initialization runs on this thread only */
+        pop_rng_seed(pop, RNG_INIT, 0);
 
-        /* read saved data from case injection; THE PROGRAM IS ASSUMED TO
-         * ONLY RUN ON DATA OF EQUAL LENGTHS UNTIL TERMINATION */
+        /* start from the packings of the most alike past problems, laid
+         * onto this one */
         size_t i = 0;
-        if (use_case_injection) {
-                /* initialize temporary file once for entire run of program */
-                if (CASE_INJECT_FILE == NULL) {
-                        CASE_INJECT_FILE = tmpfile();
-                        if (CASE_INJECT_FILE == NULL) {
-                                abort();
-                        }
+        if (cases != NULL) {
+                const size_t k = (case_k < pop.pop_sz) ? case_k : pop.pop_sz;
+                size_t **perms = malloc(k * sizeof(*perms));
+                if ((k > 0) && (perms == NULL)) {
+                        abort();
                 }
-                /* read data from temporary file as it was inserted */
-                rewind(CASE_INJECT_FILE);
-                while (i < pop.pop_sz) {
-                        size_t bytes_read = fread(POP_I(pop, i).perm,
-                                                  sizeof(size_t), pop.inst_sz,
-                                                  CASE_INJECT_FILE);
-                        if (bytes_read == 0) {
-                                if (feof(CASE_INJECT_FILE)) {
-                                        break;
-                                } else if (ferror(CASE_INJECT_FILE)) {
-                                        abort();
-                                }
-                        }
-                        i++;
+                for (size_t j = 0; j < k; j++) {
+                        perms[j] = POP_I(pop, j).perm;
                 }
+                i = case_store_find(cases, pop.prob_inst, pop.inst_sz,
+                                    pop.bin_cap, k, perms);
+                free(perms);
         }
 
         /* if there is no previous result, make one */
@@ -329,9 +739,10 @@ static int pop_init(struct population pop,
                 for (; i < pop.pop_sz; i++) {
                         memcpy(POP_I(pop, i).perm, POP_I(pop, i-1).perm,
                                sizeof(*POP_I(pop, i).perm) * pop.inst_sz);
-                        chrom_eval(&POP_I(pop, i), pop.prob_inst,
+                        chrom_eval(&POP_I(pop, i), pop.cache, pop.prob_inst,
                                    pop.inst_sz, pop.bin_cap);
                         num_searches += chrom_search(&POP_I(pop, i), false,
+                                                     pop.cache,
                                                      pop.prob_inst,
                                                      pop.inst_sz, pop.bin_cap,
                                                      true, max_searches,
@@ -352,8 +763,8 @@ static int pop_eval_foreach(void *elem,
                             void *eval_foreach_context) {
         struct eval_foreach_context *context = eval_foreach_context;
         struct chromosome *chrom = elem;
-        chrom_eval(chrom, context->pop.prob_inst, context->pop.inst_sz,
-                   context->pop.bin_cap);
+        chrom_eval(chrom, context->pop.cache, context->pop.prob_inst,
+                   context->pop.inst_sz, context->pop.bin_cap);
         return 0;
 }
 static void pop_eval(struct population pop,
@@ -364,13 +775,29 @@ static void pop_eval(struct population pop,
         parallel_foreach(max_threads, pop.chroms, pop.pop_sz,
                          chrom_size, &pop, pop_eval_foreach);
 }
+static int pop_decode_foreach(void *elem,
+                              void *eval_foreach_context) {
+        struct eval_foreach_context *context = eval_foreach_context;
+        chrom_decode(elem, context->pop.prob_inst, context->pop.inst_sz,
+                     context->pop.bin_cap);
+        return 0;
+}
+static void pop_decode(struct population pop,
+                       int max_threads) {
+        const size_t chrom_size = (pop.is_baldwinian)
+                                  ? sizeof(struct bald_chrom)
+                                  : sizeof(struct chromosome);
+        parallel_foreach(max_threads, pop.chroms, pop.pop_sz,
+                         chrom_size, &pop, pop_decode_foreach);
+}
 static int tournament_select_foreach(void *elem,
                                      void *select_foreach_context) {
         struct select_foreach_context *context = select_foreach_context;
         size_t *index = elem;
+        pop_rng_seed(context->pop, RNG_SELECT, index - context->tourn);
         size_t i1, i2;
-        i1 = rand() % context->pop.pop_sz;
-        while (i2 = rand() % context->pop.pop_sz, i2 == i1);
+        i1 = rng_bounded(context->pop.pop_sz);
+        while (i2 = rng_bounded(context->pop.pop_sz), i2 == i1);
         if (POP_I(context->pop, i1).fitness
             > POP_I(context->pop, i2).fitness) {
                 *index = i1;
@@ -383,172 +810,623 @@ static int pop_cx_foreach(void *elem,
                           void *cx_foreach_context) {
         struct cx_foreach_context *context = cx_foreach_context;
         struct chromosome *chrom = elem;
+        pop_rng_seed(context->pop, RNG_CX,
+                     pop_index(context->children, elem));
         size_t i1, i2;
-        i1 = rand() % context->tourn_count;
-        while (i2 = rand() % context->tourn_count, i2 == i1);
-        *chrom = chrom_cx(POP_I(context->pop, i1), POP_I(context->pop, i2),
-                          context->pop.inst_sz);
+        i1 = rng_bounded(context->tourn_count);
+        while (i2 = rng_bounded(context->tourn_count), i2 == i1);
+        if (context->pop.is_grouping) {
+                chrom_group_cx(chrom, POP_I(context->pop, i1),
+                               POP_I(context->pop, i2),
+                               context->pop.prob_inst, context->pop.inst_sz,
+                               context->pop.bin_cap);
+        } else {
+                chrom_cx(chrom, POP_I(context->pop, i1),
+                         POP_I(context->pop, i2), context->pop.inst_sz);
+        }
         return 0;
 }
 static void pop_cx(struct population pop,
-                   struct population *children,
+                   struct population children,
+                   struct cx_scratch scratch,
                    int max_threads) {
         pop_eval(pop, max_threads);
+        if (pop.is_grouping) {
+                /* children are bred from their parents' bins */
+                pop_decode(pop, max_threads);
+        }
+        const size_t chrom_size = (pop.is_baldwinian)
+                                  ? sizeof(struct bald_chrom)
+                                  : sizeof(struct chromosome);
 
         /* tournament selection */
         const size_t tourn_count = pop.pop_sz;
-        size_t *tourn = malloc(tourn_count * sizeof(*tourn));
-        if (tourn == NULL) {
-                abort();
-        }
-        parallel_foreach(max_threads, tourn, tourn_count, sizeof(*tourn),
-                         &pop, tournament_select_foreach);
+        struct select_foreach_context tmp0 = {.pop = pop,
+                                              .tourn = scratch.tourn};
+        parallel_foreach(max_threads, scratch.tourn, tourn_count,
+                         sizeof(*scratch.tourn), &tmp0,
+                         tournament_select_foreach);
 
-        /* initialize children */
-        children->pop_sz = pop.pop_sz;
-        children->is_baldwinian = false;
-        children->chroms = malloc(children->pop_sz
-                                  * sizeof(struct chromosome));
-        struct chromosome *chroms = children->chroms;
-        /* keep best chromosome */
-        solution_init(&chroms[0].sol);
-        pop_best_fitness(pop, &chroms[0].sol, max_threads);
-        chroms[0].perm = solution_reverse_first_fit(chroms[0].sol,
-                                                    pop.inst_sz);
-        solution_destroy(chroms[0].sol);
-        solution_init(&chroms[0].sol);
-        chroms[0].fitness = -1;
         /* crossover */
         struct cx_foreach_context tmp1 = {.pop = pop,
                                           .tourn_count = tourn_count,
-                                          .tourn = tourn};
-        parallel_foreach(max_threads, chroms + 1, children->pop_sz - 1,
-                         sizeof(*chroms), &tmp1, pop_cx_foreach);
+                                          .tourn = scratch.tourn,
+                                          .children = children};
+        parallel_foreach(max_threads,
+                         children.chroms + (pop.num_elites * chrom_size),
+                         children.pop_sz - pop.num_elites, chrom_size, &tmp1,
+                         pop_cx_foreach);
 
-        free(tourn);
+        /* keep best chromosomes, now that no child reads them */
+        pop_top(pop, scratch.elites, pop.num_elites);
+        for (size_t i = 0; i < pop.num_elites; i++) {
+                chrom_swap(pop, &POP_I(children, i),
+                           &POP_I(pop, scratch.elites[i]));
+        }
 }
-static void pop_replace(struct population pop,
-                        struct population children,
-                        int max_threads) {
+/* the k fittest by selection, earlier chromosomes winning ties */
+static void pop_top(struct population pop,
+                    size_t *top,
+                    size_t k) {
+        size_t num = 0;
         for (size_t i = 0; i < pop.pop_sz; i++) {
-                chrom_destroy(&POP_I(pop, i), pop.is_baldwinian);
-                POP_I(pop, i) = POP_I(children, i);
+                const double fitness = POP_I(pop, i).fitness;
+                size_t j = num;
+                while ((j > 0) && (POP_I(pop, top[j - 1]).fitness < fitness)) {
+                        if (j < k) {
+                                top[j] = top[j - 1];
+                        }
+                        j--;
+                }
+                if (j < k) {
+                        top[j] = i;
+                        if (num < k) {
+                                num++;
+                        }
+                }
         }
 }
-static void destroy_children(struct population *children,
-                             int max_threads) {
-        free(children->chroms);
+/* exchanges two chromosomes of pop's kind along with all their storage */
+static void chrom_swap(struct population pop,
+                       void *a,
+                       void *b) {
+        const size_t chrom_size = (pop.is_baldwinian)
+                                  ? sizeof(struct bald_chrom)
+                                  : sizeof(struct chromosome);
+        struct bald_chrom tmp;
+        memcpy(&tmp, a, chrom_size);
+        memcpy(a, b, chrom_size);
+        memcpy(b, &tmp, chrom_size);
 }
 static int pop_mut_foreach(void *elem,
                            void *mut_foreach_context) {
         struct mut_foreach_context *context = mut_foreach_context;
         struct chromosome *chrom = elem;
-        const double roll = (double)rand() / RAND_MAX;
-        if (roll <= context->mut_rate) {
-                chrom_mut(chrom, context->inst_sz);
+        pop_rng_seed(context->pop, RNG_MUT, pop_index(context->pop, elem));
+        const double roll = rng_unit();
+        if ((roll <= context->mut_rate) && context->pop.is_grouping) {
+                chrom_group_mut(chrom, context->pop.prob_inst,
+                                context->pop.inst_sz, context->pop.bin_cap);
+        } else if (roll <= context->mut_rate) {
+                chrom_mut(chrom, context->pop.inst_sz);
         }
         return 0;
 }
 static void pop_mut(struct population pop,
                     double mut_rate,
                     int max_threads) {
-        struct mut_foreach_context tmp = {.mut_rate = mut_rate,
-                                          .inst_sz = pop.inst_sz};
+        struct mut_foreach_context tmp = {.pop = pop,
+                                          .mut_rate = mut_rate};
         const size_t chrom_size = (pop.is_baldwinian)
                                   ? sizeof(struct bald_chrom)
                                   : sizeof(struct chromosome);
-        parallel_foreach(max_threads, pop.chroms + (chrom_size),
-                         pop.pop_sz - 1, chrom_size,
+        parallel_foreach(max_threads,
+                         pop.chroms + (pop.num_elites * chrom_size),
+                         pop.pop_sz - pop.num_elites, chrom_size,
                          &tmp, pop_mut_foreach);
 }
 static int pop_search_foreach(void *elem,
+                              void *num_searches,
                               void *search_foreach_context) {
         const int max_searches = 100;
         struct search_foreach_context *context = search_foreach_context;
         struct chromosome *chrom = elem;
-        chrom_eval(chrom, context->pop.prob_inst, context->pop.inst_sz,
-                   context->pop.bin_cap);
-        int tmp = chrom_search(chrom, context->pop.is_baldwinian,
-                               context->pop.prob_inst,
-                               context->pop.inst_sz,
-                               context->pop.bin_cap,
-                               true, max_searches,
-                               context->search_func);
-        while (context->is_locked);
-        context->is_locked = true;
-        context->num_searches += tmp;
-        context->is_locked = false;
+        pop_rng_seed(context->pop, RNG_SEARCH, pop_index(context->pop, elem));
+        chrom_eval(chrom, context->pop.cache, context->pop.prob_inst,
+                   context->pop.inst_sz, context->pop.bin_cap);
+        *(int *)num_searches += chrom_search(chrom,
+                                             context->pop.is_baldwinian,
+                                             context->pop.cache,
+                                             context->pop.prob_inst,
+                                             context->pop.inst_sz,
+                                             context->pop.bin_cap,
+                                             true, max_searches,
+                                             context->search_func);
         return 0;
 }
 /* returns number of searches conducted, if any */
 static int pop_search(struct population pop,
                       chrom_search_func search_func,
+                      const struct ga_tuning *tuning,
                       int max_threads) {
         if (search_func == NULL) {
                 return 0;
         }
         struct search_foreach_context tmp = {.pop = pop,
-                                             .is_locked = false,
-                                             .num_searches = 0,
                                              .search_func = search_func};
+        const struct para_reducer reducer = {.acc_sz = sizeof(int),
+                                             .init = int_zero,
+                                             .combine = int_add,
+                                             .func = pop_search_foreach};
         const size_t chrom_size = (pop.is_baldwinian)
                                   ? (sizeof(struct bald_chrom))
                                   : (sizeof(struct chromosome));
-        parallel_foreach(max_threads, pop.chroms, pop.pop_sz, chrom_size,
-                         &tmp, pop_search_foreach);
-        return tmp.num_searches;
+        int num_searches;
+        parallel_reduce(max_threads, pop.chroms, pop.pop_sz, chrom_size,
+                        &tmp, &reducer, &num_searches, tuning->search_sched,
+                        tuning->search_grain);
+        return num_searches;
+}
+static void int_zero(void *acc,
+                     void *unused) {
+        *(int *)acc = 0;
+}
+static void int_add(void *dest,
+                    const void *src,
+                    void *unused) {
+        *(int *)dest += *(const int *)src;
+}
+static void double_zero(void *acc,
+                        void *unused) {
+        *(double *)acc = 0;
+}
+static void double_add(void *dest,
+                       const void *src,
+                       void *unused) {
+        *(double *)dest += *(const double *)src;
 }
 static int pop_avg_fitness_foreach(void *elem,
-                                   void *avg_fitness_foreach_context) {
-        struct avg_fitness_foreach_context *context
-                = avg_fitness_foreach_context;
+                                   void *sum_fitness,
+                                   void *unused) {
         struct chromosome *chrom = elem;
-        while (context->is_locked);
-        context->is_locked = true;
-        context->sum_fitness += chrom->fitness;
-        context->is_locked = false;
+        *(double *)sum_fitness += chrom->fitness;
         return 0;
 }
 static double pop_avg_fitness(const struct population pop,
                               int max_threads) {
-        struct avg_fitness_foreach_context tmp = {.sum_fitness = 0,
-                                                  .is_locked = 0};
+        const struct para_reducer reducer = {.acc_sz = sizeof(double),
+                                             .init = double_zero,
+                                             .combine = double_add,
+                                             .func = pop_avg_fitness_foreach};
         const size_t chrom_size = (pop.is_baldwinian)
                                   ? sizeof(struct bald_chrom)
                                   : sizeof(struct chromosome);
-        parallel_foreach(max_threads, pop.chroms, pop.pop_sz,
-                         chrom_size, &tmp, pop_avg_fitness_foreach);
-        return tmp.sum_fitness / pop.pop_sz;
+        double sum_fitness;
+        parallel_reduce(max_threads, pop.chroms, pop.pop_sz, chrom_size,
+                        NULL, &reducer, &sum_fitness, PARA_STATIC, 1);
+        return sum_fitness / pop.pop_sz;
+}
+static void best_fitness_init(void *acc,
+                              void *unused) {
+        *(struct best_fitness_acc *)acc
+                = (struct best_fitness_acc){.best_fitness = -1,
+                                            .best_chrom = NULL};
+}
+static void best_fitness_combine(void *dest,
+                                 const void *src,
+                                 void *unused) {
+        struct best_fitness_acc *destv = dest;
+        const struct best_fitness_acc *srcv = src;
+        if (srcv->best_chrom == NULL) {
+                return;
+        }
+        if ((destv->best_chrom == NULL)
+            || (srcv->best_fitness > destv->best_fitness)
+            || ((srcv->best_fitness == destv->best_fitness)
+                && (srcv->best_chrom < destv->best_chrom))) {
+                *destv = *srcv;
+        }
 }
 static int pop_best_fitness_foreach(void *elem,
-                                    void *fitness_foreach_context) {
-        struct fitness_foreach_context *context = fitness_foreach_context;
+                                    void *best_fitness_acc,
+                                    void *unused) {
+        struct best_fitness_acc *acc = best_fitness_acc;
         struct chromosome *chrom = elem;
-        while (context->is_locked); // mutex lock
-        context->is_locked = true;
-        if (chrom->fitness > context->best_fitness) {
-                context->best_fitness = chrom->fitness;
-                context->best_chrom = chrom;
+        /* a slot sees its elements in order, so the first best stays */
+        if ((acc->best_chrom == NULL)
+            || (chrom->fitness > acc->best_fitness)) {
+                acc->best_fitness = chrom->fitness;
+                acc->best_chrom = chrom;
         }
-        context->is_locked = false;
         return 0;
 }
 static double pop_best_fitness(const struct population pop,
                                struct solution *best_sol_copy,
                                int max_threads) {
-        struct fitness_foreach_context tmp = {.best_fitness = 0,
-                                              .is_locked = false};
+        const struct para_reducer reducer = {
+                .acc_sz = sizeof(struct best_fitness_acc),
+                .init = best_fitness_init,
+                .combine = best_fitness_combine,
+                .func = pop_best_fitness_foreach};
         const size_t chrom_size = (pop.is_baldwinian)
                                   ? sizeof(struct bald_chrom)
                                   : sizeof(struct chromosome);
-        parallel_foreach(max_threads, pop.chroms, pop.pop_sz, chrom_size,
-                         &tmp, pop_best_fitness_foreach);
+        struct best_fitness_acc tmp;
+        parallel_reduce(max_threads, pop.chroms, pop.pop_sz, chrom_size,
+                        NULL, &reducer, &tmp, PARA_STATIC, 1);
         const struct solution *src_ptr;
         if (pop.is_baldwinian) {
                 src_ptr = &((struct bald_chrom *)tmp.best_chrom)->bald_sol;
         } else {
+                chrom_decode(tmp.best_chrom, pop.prob_inst, pop.inst_sz,
+                             pop.bin_cap);
                 src_ptr = &tmp.best_chrom->sol;
         }
-        solution_copy(best_sol_copy, *src_ptr);
+        solution_assign(best_sol_copy, *src_ptr);
         return tmp.best_fitness;
 }
+/* the least fit chromosome, later ones winning ties so as to spare the
+ * elites at the front */
+static struct chromosome *pop_worst(struct population pop) {
+        struct chromosome *worst = &POP_I(pop, 0);
+        for (size_t i = 1; i < pop.pop_sz; i++) {
+                if (POP_I(pop, i).fitness <= worst->fitness) {
+                        worst = &POP_I(pop, i);
+                }
+        }
+        return worst;
+}
+
+static void island_alloc(struct island *isl,
+                         struct ga_run *run,
+                         struct population proto,
+                         int max_threads) {
+        isl->run = run;
+        isl->pop = proto;
+        isl->next = proto;
+        isl->max_threads = max_threads;
+        pop_alloc(&isl->pop, max_threads);
+        pop_alloc(&isl->next, max_threads);
+        const size_t num_elites = proto.num_elites;
+        const size_t num_migrants = (run->tuning->migrants < proto.pop_sz)
+                                    ? run->tuning->migrants : proto.pop_sz;
+        isl->scratch.tourn = malloc(proto.pop_sz
+                                    * sizeof(*isl->scratch.tourn));
+        isl->scratch.elites = malloc(num_elites
+                                     * sizeof(*isl->scratch.elites));
+        isl->emigrants = malloc(num_migrants * sizeof(*isl->emigrants));
+        isl->arrival = malloc(proto.inst_sz * sizeof(*isl->arrival));
+        if ((isl->scratch.tourn == NULL)
+            || ((isl->scratch.elites == NULL) && (num_elites > 0))
+            || ((isl->emigrants == NULL) && (num_migrants > 0))
+            || ((isl->arrival == NULL) && (proto.inst_sz > 0))) {
+                abort();
+        }
+        isl->out = NULL;
+        isl->in = NULL;
+        solution_init(&isl->best_sol);
+        isl->fewest_bins = INT_MAX;
+        isl->fewest_bins_time = 0.0;
+}
+static void island_free(struct island *isl) {
+        pop_free(isl->pop);
+        pop_free(isl->next);
+        free(isl->scratch.tourn);
+        free(isl->scratch.elites);
+        free(isl->emigrants);
+        free(isl->arrival);
+        solution_destroy(isl->best_sol);
+}
+static void island_start(struct island *isl,
+                         enum init_type init,
+                         struct case_store *cases) {
+        struct ga_run *run = isl->run;
+        isl->num_gens = 1;
+        isl->num_searches = pop_init(isl->pop, init, run->search_func,
+                                     cases, run->tuning->case_k);
+        pop_eval(isl->pop, isl->max_threads);
+        isl->best_fitness = pop_best_fitness(isl->pop, &isl->best_sol,
+                                             isl->max_threads);
+        isl->avg_fitness = pop_avg_fitness(isl->pop, isl->max_threads);
+        island_track_best(isl);
+        island_publish(isl);
+}
+static bool island_is_running(const struct island *isl) {
+        const struct ga_run *run = isl->run;
+        return (isl->num_gens < run->max_generations)
+               && (time_elapsed(&run->time_start) <= run->max_time)
+               && !atomic_load_explicit(&run->board->is_done,
+                                        memory_order_relaxed);
+}
+static void island_step(struct island *isl) {
+        struct ga_run *run = isl->run;
+        const int interval = run->tuning->migration_interval;
+        isl->num_gens++;
+        isl->pop.epoch = isl->num_gens;
+        isl->next.epoch = isl->num_gens;
+        pop_cx(isl->pop, isl->next, isl->scratch, isl->max_threads);
+        void *tmp = isl->pop.chroms;
+        isl->pop.chroms = isl->next.chroms;
+        isl->next.chroms = tmp;
+
+        if (!run->use_local_search) {
+                pop_mut(isl->pop, run->mut_rate, isl->max_threads);
+        } else {
+                isl->num_searches += pop_search(isl->pop, run->search_func,
+                                                run->tuning,
+                                                isl->max_threads);
+        }
+
+        pop_eval(isl->pop, isl->max_threads);
+        if ((isl->out != NULL) && (isl->num_gens % interval == 0)) {
+                island_migrate(isl);
+        }
+        isl->best_fitness = pop_best_fitness(isl->pop, &isl->best_sol,
+                                             isl->max_threads);
+        isl->avg_fitness = pop_avg_fitness(isl->pop, isl->max_threads);
+        island_track_best(isl);
+}
+static void island_track_best(struct island *isl) {
+        struct ga_run *run = isl->run;
+        if (isl->best_sol.num_bins < isl->fewest_bins) {
+                isl->fewest_bins = isl->best_sol.num_bins;
+                isl->fewest_bins_time = time_elapsed(&run->time_start);
+        }
+        if (isl->best_sol.num_bins <= run->stop_bins) {
+                atomic_store(&run->board->is_done, true);
+        }
+}
+static void island_migrate(struct island *isl) {
+        struct population pop = isl->pop;
+        const size_t num_migrants = (isl->run->tuning->migrants < pop.pop_sz)
+                                    ? isl->run->tuning->migrants
+                                    : pop.pop_sz;
+        pop_top(pop, isl->emigrants, num_migrants);
+        for (size_t i = 0; i < num_migrants; i++) {
+                const struct chromosome *chrom = &POP_I(pop,
+                                                        isl->emigrants[i]);
+                /* a full ring means the neighbour is behind; drop it */
+                migrant_ring_push(isl->out, chrom->perm, chrom->fitness);
+        }
+        double fitness;
+        while (migrant_ring_pop(isl->in, isl->arrival, &fitness)) {
+                struct chromosome *worst = pop_worst(pop);
+                if (!(fitness > worst->fitness)) {
+                        continue;
+                }
+                size_t *tmp = worst->perm;
+                worst->perm = isl->arrival;
+                isl->arrival = tmp;
+                /* the sender's fitness holds for the same instance; the
+                 * solution is decoded lazily, as after a cache hit */
+                worst->fitness = fitness;
+                worst->hash = perm_hash(worst->perm, pop.inst_sz);
+                solution_clear(&worst->sol);
+                ff_checkpoints_invalidate(&worst->cp);
+                if (pop.is_baldwinian) {
+                        solution_clear(&((struct bald_chrom *)worst)
+                                       ->bald_sol);
+                }
+                /* a grouping sender's fitness was of its bins, which
+                 * first-fit of perm may pack tighter */
+                if (pop.is_grouping) {
+                        worst->fitness = -1;
+                        chrom_eval(worst, pop.cache, pop.prob_inst,
+                                   pop.inst_sz, pop.bin_cap);
+                }
+        }
+}
+static void island_publish(struct island *isl) {
+        atomic_store_explicit(&isl->shown->best_fitness, isl->best_fitness,
+                              memory_order_relaxed);
+        atomic_store_explicit(&isl->shown->avg_fitness, isl->avg_fitness,
+                              memory_order_relaxed);
+        atomic_store_explicit(&isl->shown->best_num_bins,
+                              isl->best_sol.num_bins, memory_order_relaxed);
+        atomic_store_explicit(&isl->shown->num_searches, isl->num_searches,
+                              memory_order_relaxed);
+        atomic_store_explicit(&isl->shown->num_gens, isl->num_gens,
+                              memory_order_relaxed);
+        atomic_store_explicit(&isl->shown->fewest_bins, isl->fewest_bins,
+                              memory_order_relaxed);
+        atomic_store_explicit(&isl->shown->fewest_bins_time,
+                              isl->fewest_bins_time, memory_order_relaxed);
+}
+static void island_report(struct island *isl) {
+        island_publish(isl);
+        struct ga_run *run = isl->run;
+        if (isl != &run->islands[0]) {
+                return;
+        }
+        /* the other islands' figures may be a generation or so apart */
+        int best_num_bins = INT_MAX;
+        double best_fitness = 0.0;
+        double sum_avg_fitness = 0.0;
+        int num_searches = 0;
+        for (size_t i = 0; i < run->num_islands; i++) {
+                const struct island *other = &run->islands[i];
+                const int num_bins = atomic_load_explicit(
+                        &other->shown->best_num_bins, memory_order_relaxed);
+                const double fitness = atomic_load_explicit(
+                        &other->shown->best_fitness, memory_order_relaxed);
+                if (num_bins < best_num_bins) {
+                        best_num_bins = num_bins;
+                }
+                if ((i == 0) || (fitness > best_fitness)) {
+                        best_fitness = fitness;
+                }
+                sum_avg_fitness += atomic_load_explicit(
+                        &other->shown->avg_fitness, memory_order_relaxed);
+                num_searches += atomic_load_explicit(
+                        &other->shown->num_searches, memory_order_relaxed);
+        }
+        print_gen(run->out, isl->pop, isl->num_gens,
+                  time_elapsed(&run->time_start), best_num_bins,
+                  best_fitness, sum_avg_fitness / run->num_islands,
+                  num_searches);
+}
+static void *island_main(void *island) {
+        struct island *isl = island;
+        while (island_is_running(isl)) {
+                island_step(isl);
+                island_report(isl);
+        }
+        return NULL;
+}
+
+static struct island_board *board_alloc(size_t num_islands,
+                                        size_t ring_cap,
+                                        size_t inst_sz,
+                                        bool is_shared) {
+        const size_t line = 64;
+#define LINES(SZ)       ((((SZ) + line - 1) / line) * line)
+        const size_t ring_size = (ring_cap > 0)
+                                 ? LINES(migrant_ring_size(ring_cap, inst_sz))
+                                 : 0;
+        const size_t shown_at = LINES(sizeof(struct island_board));
+        const size_t rings_at = shown_at
+                                + LINES(num_islands
+                                        * sizeof(struct island_shown));
+        const size_t perms_at = rings_at + num_islands * ring_size;
+        const size_t size = perms_at + ((is_shared)
+                                        ? LINES(num_islands * inst_sz
+                                                * sizeof(size_t))
+                                        : 0);
+#undef LINES
+        unsigned char *block;
+        if (is_shared) {
+                block = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+                if (block == MAP_FAILED) {
+                        abort();
+                }
+        } else {
+                block = aligned_alloc(line, size);
+                if (block == NULL) {
+                        abort();
+                }
+        }
+        struct island_board *board = (struct island_board *)block;
+        board->size = size;
+        board->is_shared = is_shared;
+        atomic_init(&board->is_done, false);
+        board->shown = (struct island_shown *)(block + shown_at);
+        board->rings = block + rings_at;
+        board->ring_size = ring_size;
+        board->best_perms = (is_shared) ? (size_t *)(block + perms_at) : NULL;
+        for (size_t i = 0; i < num_islands; i++) {
+                if (ring_cap > 0) {
+                        migrant_ring_init((struct migrant_ring *)
+                                          (board->rings + i * ring_size),
+                                          ring_cap, inst_sz);
+                }
+        }
+        return board;
+}
+static void board_free(struct island_board *board) {
+        if (board->is_shared) {
+                munmap(board, board->size);
+        } else {
+                free(board);
+        }
+}
+static void islands_run_threads(struct ga_run *run) {
+        pthread_t *threads = malloc((run->num_islands - 1)
+                                    * sizeof(*threads));
+        if (threads == NULL) {
+                abort();
+        }
+        for (size_t i = 1; i < run->num_islands; i++) {
+                /* every island breeds on its own thread alone */
+                run->islands[i].max_threads = 1;
+                if (pthread_create(&threads[i - 1], NULL, island_main,
+                                   &run->islands[i]) != 0) {
+                        abort();
+                }
+        }
+        run->islands[0].max_threads = 1;
+        island_main(&run->islands[0]);
+        for (size_t i = 1; i < run->num_islands; i++) {
+                pthread_join(threads[i - 1], NULL);
+        }
+        free(threads);
+}
+static void islands_run_procs(struct ga_run *run) {
+        const struct population proto = run->islands[0].pop;
+        pid_t *pids = malloc(run->num_islands * sizeof(*pids));
+        if (pids == NULL) {
+                abort();
+        }
+        /* a child starts with only the forking thread and must not
+         * inherit output still to be flushed; as each island breeds on
+         * one thread, it never waits on the pool's missing workers */
+        fflush(run->out);
+        for (size_t i = 0; i < run->num_islands; i++) {
+                struct island *isl = &run->islands[i];
+                isl->max_threads = 1;
+                pids[i] = fork();
+                if (pids[i] != 0) {
+                        continue;
+                }
+                /* the child breeds island i in its own heap; pages of the
+                 * population are copied, and so placed, as it writes them */
+                island_main(isl);
+                solution_reverse_first_fit_into(isl->best_sol,
+                        run->board->best_perms + i * proto.inst_sz);
+                fflush(run->out);
+                _exit(0);
+        }
+        for (size_t i = 0; i < run->num_islands; i++) {
+                if (pids[i] < 0) {
+                        continue;
+                }
+                int status;
+                pid_t waited;
+                while (((waited = waitpid(pids[i], &status, 0)) < 0)
+                       && (errno == EINTR)) {
+                }
+                /* e.g. ECHILD if a SIGCHLD handler reaped it first */
+                if ((waited < 0) || !WIFEXITED(status)
+                    || (WEXITSTATUS(status) != 0)) {
+                        continue;
+                }
+                struct island *isl = &run->islands[i];
+                solution_first_fit(&isl->best_sol, proto.prob_inst,
+                                   proto.inst_sz,
+                                   run->board->best_perms
+                                   + i * proto.inst_sz,
+                                   proto.bin_cap);
+                isl->best_fitness = solution_eval(isl->best_sol,
+                                                  proto.bin_cap);
+        }
+        free(pids);
+}
+static void run_stats(const struct ga_run *run,
+                      struct ga_stats *stats) {
+        *stats = (struct ga_stats){.elapsed = time_elapsed(&run->time_start),
+                                   .num_gens = 0,
+                                   .best_num_bins = INT_MAX,
+                                   .time_to_best = 0.0,
+                                   .stop_bins = run->stop_bins,
+                                   .time_to_stop = -1,
+                                   .num_decodes = solution_first_fit_count()
+                                                  - run->start_decodes};
+        for (size_t i = 0; i < run->num_islands; i++) {
+                const struct island_shown *shown = &run->board->shown[i];
+                const int num_bins = atomic_load_explicit(
+                        &shown->fewest_bins, memory_order_relaxed);
+                const double time = atomic_load_explicit(
+                        &shown->fewest_bins_time, memory_order_relaxed);
+                stats->num_gens += atomic_load_explicit(&shown->num_gens,
+                                                        memory_order_relaxed);
+                if ((num_bins < stats->best_num_bins)
+                    || ((num_bins == stats->best_num_bins)
+                        && (time < stats->time_to_best))) {
+                        stats->best_num_bins = num_bins;
+                        stats->time_to_best = time;
+                }
+        }
+        if (stats->best_num_bins <= stats->stop_bins) {
+                stats->time_to_stop = stats->time_to_best;
+        }
+}
@@ -4,7 +4,10 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "bp-solution.h"
+#include "parallel-foreach.h"
+#include "case-store.h"
 
 enum init_type {
         SUCCESSIVE_MUT,
@@ -21,9 +24,80 @@ enum search_adaptation_type {
         BALDWINIAN
 };
 
+/* how a run went, for benchmarks; times are seconds from its start */
+struct ga_stats {
+        double elapsed;
+        /* generations bred, summed over the islands */
+        long num_gens;
+        /* the fewest bins of any packing the run found, and when it was
+         * first found */
+        int best_num_bins;
+        double time_to_best;
+        /* the bins that prove a packing optimal (see genetic_algorithm),
+         * and when the run reached them, or -1 if it did not */
+        int stop_bins;
+        double time_to_stop;
+        /* solution_first_fit_count over the run, so concurrent runs in
+         * the process count one another's; islands run as processes are
+         * left out */
+        size_t num_decodes;
+};
+
+/* knobs that change how the algorithm runs rather than what it computes */
+struct ga_tuning {
+        /* schedule and chunk size of the local search phase, whose cost
+         * per chromosome varies wildly under greedy search */
+        enum para_schedule search_sched;
+        size_t search_grain;
+        /* master seed; a run is repeatable for a given seed */
+        uint64_t seed;
+        /* first-fit implementation, selected for the whole process */
+        enum first_fit_impl decoder;
+        /* decode in integer units when every size is integral after
+         * scaling by a power of ten (see int-inst.h) */
+        bool int_sizes;
+        /* log2 of the entries in the fitness cache; 0 turns it off */
+        int cache_bits;
+        /* number of fittest chromosomes carried over intact each
+         * generation; at most the population size minus one */
+        size_t elites;
+        /* Number of populations evolving side by side, each on a thread
+         * of its own that ignores max_threads; 1 runs a single population
+         * on max_threads. Every migration_interval generations an island
+         * sends copies of its fittest migrants chromosomes to the next
+         * island in a ring, where they replace the least fit; 0 for
+         * either turns migration off. Island runs do not repeat exactly,
+         * as what arrives depends on how far each thread has got. */
+        size_t islands;
+        int migration_interval;
+        size_t migrants;
+        /* Run the islands as child processes rather than threads, each
+         * with a heap of its own, exchanging migrants through memory
+         * shared between them; the calling process only waits for them
+         * and collects the best packing. Only a run alone in the process
+         * forks: while other runs are under way it keeps to threads, and
+         * runs started meanwhile wait for it to end. Other users of the
+         * parallel_foreach pool carry on undisturbed. */
+        bool island_procs;
+        /* Where case injection finds past packings and adds this run's
+         * best, and how many of the most alike it starts from, at most
+         * the population size. NULL shares a store in memory between all
+         * runs of the process. */
+        struct case_store *case_store;
+        size_t case_k;
+};
+void ga_tuning_init(struct ga_tuning *tuning);
+
+/* A run ends as soon as its best packing has as few bins as a lower bound,
+ * or as known_optimum, proving it optimal. The run computes the bound (see
+ * lower-bound.h) unless given one, such as a binary problem file's; 0 for
+ * either if unknown. tuning may be NULL to use the defaults from
+ * ga_tuning_init; stats, unless NULL, is filled in as the run ends. */
 struct solution genetic_algorithm(const double *prob_inst,
                                   size_t inst_sz,
                                   double bin_cap,
+                                  size_t lower_bound,
+                                  size_t known_optimum,
                                   bool use_case_injection,
                                   enum init_type init,
                                   bool use_local_search,
@@ -32,6 +106,45 @@ struct solution genetic_algorithm(const double *prob_inst,
                                   int max_threads,
                                   int max_generations,
                                   double max_time,
-                                  FILE *out);
+                                  FILE *out,
+                                  const struct ga_tuning *tuning,
+                                  struct ga_stats *stats);
+/* The same run with Falkenauer's grouping operators (see chrom_group_cx)
+ * in place of OX and swap mutation: children take whole bins from their
+ * parents and are evaluated from them, decoding only the chromosomes
+ * that local search changes or migration brings in. */
+struct solution grouping_genetic_algorithm(const double *prob_inst,
+                                           size_t inst_sz,
+                                           double bin_cap,
+                                           size_t lower_bound,
+                                           size_t known_optimum,
+                                           bool use_case_injection,
+                                           enum init_type init,
+                                           bool use_local_search,
+                                           enum search_type search,
+                                           enum search_adaptation_type adapt,
+                                           int max_threads,
+                                           int max_generations,
+                                           double max_time,
+                                           FILE *out,
+                                           const struct ga_tuning *tuning,
+                                           struct ga_stats *stats);
+/* either of the above */
+typedef struct solution (*ga_engine_func)(const double *prob_inst,
+                                          size_t inst_sz,
+                                          double bin_cap,
+                                          size_t lower_bound,
+                                          size_t known_optimum,
+                                          bool use_case_injection,
+                                          enum init_type init,
+                                          bool use_local_search,
+                                          enum search_type search,
+                                          enum search_adaptation_type adapt,
+                                          int max_threads,
+                                          int max_generations,
+                                          double max_time,
+                                          FILE *out,
+                                          const struct ga_tuning *tuning,
+                                          struct ga_stats *stats);
 
 #endif /* !BIN_PACKING_H */
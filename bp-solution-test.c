@@ -1,7 +1,23 @@
 #include "bp-solution.h"
+#include "int-inst.h"
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* solution_eval and bin count of sol with item_bin as given, by brute
+ * force; bins may be left empty */
+static double eval_moved(struct solution sol,
+                         const int *item_bin,
+                         const double *prob_inst,
+                         double bin_cap,
+                         int *num_bins);
+/* number of moves on sol whose deltas disagree with eval_moved */
+static int check_moves(struct solution sol,
+                       const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap);
 
 int main(int argc, char **argv) {
         struct solution sol;
@@ -27,7 +43,128 @@ int main(int argc, char **argv) {
         printf("solution Falkenauer fitness: %lf\n",
                solution_eval(sol, bin_cap));
 
+        printf("swapping bins 0 and 2\n");
+        solution_swap_bins(&sol, 0, 2);
+        solution_print(sol, stdout);
+
+        struct solution sol_copy;
+        solution_copy(&sol_copy, sol);
+        printf("copy:\n");
+        solution_print(sol_copy, stdout);
+        solution_reverse_first_fit_into(sol_copy, new_perm);
+        for (size_t i = 0; i < arr_sz; i++) {
+                printf("%zu ", new_perm[i]);
+        }
+        putchar('\n');
+
+        /* 0.3 + 7.9 + 1.8 exceeds 10.0 in doubles but fits exactly */
+        const double tenths[] = {0.3, 7.9, 1.8};
+        const size_t tenths_perm[] = {0, 1, 2};
+        solution_first_fit(&sol, tenths, 3, tenths_perm, 10.0);
+        printf("tenths in doubles: %d bins\n", sol.num_bins);
+        int_inst_register(tenths, 3, 10.0);
+        solution_first_fit(&sol, tenths, 3, tenths_perm, 10.0);
+        printf("tenths in integers: %d bins\n", sol.num_bins);
+        solution_print(sol, stdout);
+        int_inst_unregister(tenths);
+
+        solution_first_fit(&sol, arr, arr_sz, perm, bin_cap);
+        struct move_eval me;
+        move_eval_init(&me, &sol, arr, arr_sz, bin_cap);
+        struct move_delta d = move_eval_relocate(&me, 9, 2);
+        printf("item 9 to bin 2: %+lf fitness, %+d bins, fits %d\n",
+               d.fitness, d.num_bins, d.fits);
+        d = move_eval_swap(&me, 0, 4);
+        printf("items 0 and 4 swapped: %+lf fitness, %+d bins, fits %d\n",
+               d.fitness, d.num_bins, d.fits);
+        d = move_eval_merge(&me, 2, 1);
+        printf("bin 2 into bin 1: %+lf fitness, %+d bins, fits %d\n",
+               d.fitness, d.num_bins, d.fits);
+        printf("moves off in doubles: %d\n",
+               check_moves(sol, arr, arr_sz, bin_cap));
+        int_inst_register(arr, arr_sz, bin_cap);
+        solution_first_fit(&sol, arr, arr_sz, perm, bin_cap);
+        printf("moves off in integers: %d\n",
+               check_moves(sol, arr, arr_sz, bin_cap));
+        int_inst_unregister(arr);
+
         free(new_perm);
+        solution_destroy(sol_copy);
         solution_destroy(sol);
         return 0;
 }
+
+static double eval_moved(struct solution sol,
+                         const int *item_bin,
+                         const double *prob_inst,
+                         double bin_cap,
+                         int *num_bins) {
+        double *load = calloc(sol.num_items + 1, sizeof(*load));
+        int *num_items = calloc(sol.num_items + 1, sizeof(*num_items));
+        if ((load == NULL) || (num_items == NULL)) {
+                abort();
+        }
+        for (size_t i = 0; i < sol.num_items; i++) {
+                load[item_bin[i]] += prob_inst[i];
+                num_items[item_bin[i]]++;
+        }
+        double sum = 0;
+        *num_bins = 0;
+        for (size_t j = 0; j <= sol.num_items; j++) {
+                sum += load[j] * load[j];
+                *num_bins += num_items[j] > 0;
+        }
+        free(load);
+        free(num_items);
+        return sum / (bin_cap * bin_cap * *num_bins);
+}
+static int check_moves(struct solution sol,
+                       const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap) {
+        struct move_eval me;
+        move_eval_init(&me, &sol, prob_inst, inst_sz, bin_cap);
+        int *item_bin = malloc(inst_sz * sizeof(*item_bin));
+        if (item_bin == NULL) {
+                abort();
+        }
+        const double fitness = solution_eval(sol, bin_cap);
+        int num_off = 0;
+        int num_bins;
+        double moved;
+#define CHECK_MOVE(DELTA) \
+        do { \
+                moved = eval_moved(sol, item_bin, prob_inst, bin_cap, \
+                                   &num_bins); \
+                num_off += (fabs((DELTA).fitness - (moved - fitness)) \
+                            > 1e-12) \
+                           || ((DELTA).num_bins != num_bins - sol.num_bins); \
+        } while (0)
+        for (size_t i = 0; i < inst_sz; i++) {
+                for (int to = 0; to <= sol.num_bins; to++) {
+                        memcpy(item_bin, sol.item_bin,
+                               inst_sz * sizeof(*item_bin));
+                        item_bin[i] = to;
+                        CHECK_MOVE(move_eval_relocate(&me, i, to));
+                }
+                for (size_t k = 0; k < inst_sz; k++) {
+                        memcpy(item_bin, sol.item_bin,
+                               inst_sz * sizeof(*item_bin));
+                        item_bin[i] = sol.item_bin[k];
+                        item_bin[k] = sol.item_bin[i];
+                        CHECK_MOVE(move_eval_swap(&me, i, k));
+                }
+        }
+        for (int from = 0; from < sol.num_bins; from++) {
+                for (int to = 0; to < sol.num_bins; to++) {
+                        for (size_t i = 0; i < inst_sz; i++) {
+                                item_bin[i] = (sol.item_bin[i] == from)
+                                              ? to : sol.item_bin[i];
+                        }
+                        CHECK_MOVE(move_eval_merge(&me, from, to));
+                }
+        }
+#undef CHECK_MOVE
+        free(item_bin);
+        return num_off;
+}
@@ -1,10 +1,107 @@
 #include "bp-solution.h"
+#include "arena.h"
+#include "int-inst.h"
+#include "ff-scan.h"
 #include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdatomic.h>
 
-static int bin_rff(struct bin bin,
-                   size_t *restrict dest_perm);
+static size_t block_size(size_t cap);
+static void solution_layout(struct solution *restrict sol,
+                            void *block,
+                            size_t cap);
+static void solution_reserve(struct solution *restrict sol,
+                             size_t cap);
+static void items_reverse(size_t *items,
+                          size_t len);
+static enum first_fit_impl first_fit_selected(void);
+static int pack(enum first_fit_impl impl,
+                struct solution *restrict sol,
+                const double *restrict prob_inst,
+                size_t inst_sz,
+                const size_t *restrict perm,
+                double bin_cap,
+                size_t from,
+                int num_bins,
+                struct ff_checkpoints *restrict cp);
+static int pack_linear(struct solution *restrict sol,
+                       const double *restrict prob_inst,
+                       size_t inst_sz,
+                       const size_t *restrict perm,
+                       double bin_cap,
+                       size_t from,
+                       int num_bins,
+                       struct ff_checkpoints *restrict cp);
+static int pack_tree(struct solution *restrict sol,
+                     const double *restrict prob_inst,
+                     size_t inst_sz,
+                     const size_t *restrict perm,
+                     double bin_cap,
+                     size_t from,
+                     int num_bins,
+                     struct ff_checkpoints *restrict cp);
+static int pack_int(enum first_fit_impl impl,
+                    struct solution *restrict sol,
+                    const struct int_inst *restrict ii,
+                    const size_t *restrict perm,
+                    size_t from,
+                    int num_bins,
+                    struct ff_checkpoints *restrict cp);
+static int pack_linear_int(struct solution *restrict sol,
+                           uint32_t *restrict load,
+                           const struct int_inst *restrict ii,
+                           const size_t *restrict perm,
+                           size_t from,
+                           int num_bins,
+                           struct ff_checkpoints *restrict cp);
+static int pack_tree_int(struct solution *restrict sol,
+                         uint32_t *restrict load,
+                         const struct int_inst *restrict ii,
+                         const size_t *restrict perm,
+                         size_t from,
+                         int num_bins,
+                         struct ff_checkpoints *restrict cp);
+static void loads_from_int(double *restrict load,
+                           const uint32_t *restrict int_load,
+                           int num_bins,
+                           double scale);
+static double *checkpoint_loads(const struct ff_checkpoints *cp,
+                                size_t c);
+/* the load of bin once item in joins it and item out leaves, either
+ * being NO_ITEM for none */
+static double load_after(const struct move_eval *me,
+                         int bin,
+                         size_t out,
+                         size_t in,
+                         bool *fits);
+/* the move that leaves bin1 and bin2 at load1 and load2 */
+static struct move_delta move_delta(const struct move_eval *me,
+                                    int bin1,
+                                    double load1,
+                                    int bin2,
+                                    double load2,
+                                    int num_bins_delta,
+                                    bool fits);
+static void checkpoint_record(struct ff_checkpoints *restrict cp,
+                              size_t c,
+                              const double *restrict load,
+                              int num_bins);
+static void checkpoints_reserve(struct ff_checkpoints *restrict cp,
+                                size_t inst_sz);
+static void solution_group(struct solution *restrict sol,
+                           int num_bins,
+                           size_t inst_sz,
+                           const size_t *restrict perm);
+
+#define CHECKPOINTS             16
+#define MIN_CHECKPOINT_INTERVAL 16
+
+/* an enum first_fit_impl; atomic as concurrent runs each select it */
+static atomic_int first_fit_impl = FIRST_FIT_LINEAR;
+static atomic_size_t first_fit_count;
 
 void bin_init(struct bin *restrict bin) {
         *bin = (struct bin){.num_items = 0,
@@ -44,77 +141,251 @@ void bin_print(struct bin bin,
 
 void solution_init(struct solution *restrict sol) {
         *sol = (struct solution){.num_bins = 0,
-                                 .bins = NULL};
+                                 .num_items = 0,
+                                 .cap = 0,
+                                 .items = NULL,
+                                 .bin_start = NULL,
+                                 .bin_load = NULL,
+                                 .item_bin = NULL};
 }
 void solution_add(struct solution *restrict sol,
                   struct bin bin) {
+        size_t cap = sol->num_items + bin.num_items;
+        if (cap < (size_t)sol->num_bins + 1) {
+                cap = sol->num_bins + 1;
+        }
+        for (int i = 0; i < bin.num_items; i++) {
+                if (cap <= bin.item_indices[i]) {
+                        cap = bin.item_indices[i] + 1;
+                }
+        }
+        if (cap > sol->cap) {
+                if (cap < sol->cap * 2) {
+                        cap = sol->cap * 2;
+                }
+                solution_reserve(sol, cap);
+        }
+
+        memcpy(sol->items + sol->num_items, bin.item_indices,
+               bin.num_items * sizeof(*sol->items));
+        for (int i = 0; i < bin.num_items; i++) {
+                sol->item_bin[bin.item_indices[i]] = sol->num_bins;
+        }
+        sol->bin_load[sol->num_bins] = bin.item_sum;
         sol->num_bins++;
-        sol->bins = realloc(sol->bins,
-                            sol->num_bins * sizeof(*sol->bins));
-        sol->bins[sol->num_bins - 1] = bin;
+        sol->num_items += bin.num_items;
+        sol->bin_start[sol->num_bins] = sol->num_items;
+        free(bin.item_indices);
 }
 void solution_destroy(struct solution s) {
-        if (s.bins == NULL) {
-                return;
-        }
-        for (int i = 0; i < s.num_bins; i++) {
-                free(s.bins[i].item_indices);
+        free(s.items);
+}
+void solution_clear(struct solution *restrict sol) {
+        sol->num_bins = 0;
+        sol->num_items = 0;
+        if (sol->cap > 0) {
+                sol->bin_start[0] = 0;
         }
-        free(s.bins);
 }
 void solution_copy(struct solution *restrict dest,
                    const struct solution src) {
-        *dest = (struct solution){.num_bins = src.num_bins,
-                                  .bins = malloc(src.num_bins
-                                                 * sizeof(*dest->bins))};
-        if (dest->bins == NULL) {
-                abort();
+        solution_init(dest);
+        solution_assign(dest, src);
+}
+void solution_assign(struct solution *restrict dest,
+                     const struct solution src) {
+        if (dest->cap != src.cap) {
+                /* the layout depends on cap, so match it exactly */
+                solution_destroy(*dest);
+                solution_init(dest);
+                solution_reserve(dest, src.cap);
+        }
+        if (src.cap > 0) {
+                memcpy(dest->items, src.items, block_size(src.cap));
         }
-        for (int i = 0; i < dest->num_bins; i++) {
-                bin_copy(dest->bins + i, src.bins[i]);
+        dest->num_bins = src.num_bins;
+        dest->num_items = src.num_items;
+}
+struct bin solution_bin(struct solution sol,
+                        int i) {
+        return (struct bin){.item_sum = sol.bin_load[i],
+                            .num_items = sol.bin_start[i + 1]
+                                         - sol.bin_start[i],
+                            .item_indices = sol.items + sol.bin_start[i]};
+}
+/* block swap by three reversals; only the bins between i1 and i2 move */
+void solution_swap_bins(struct solution *restrict sol,
+                        int i1,
+                        int i2) {
+        if (i1 == i2) {
+                return;
         }
+        if (i1 > i2) {
+                int tmp = i1;
+                i1 = i2;
+                i2 = tmp;
+        }
+        size_t *start = sol->bin_start;
+        const size_t len1 = start[i1 + 1] - start[i1];
+        const size_t len2 = start[i2 + 1] - start[i2];
+        const size_t len_mid = start[i2] - start[i1 + 1];
+        size_t *seg = sol->items + start[i1];
+        items_reverse(seg, len1 + len_mid + len2);
+        items_reverse(seg, len2);
+        items_reverse(seg + len2, len_mid);
+        items_reverse(seg + len2 + len_mid, len1);
+
+        for (int k = i1 + 1; k <= i2; k++) {
+                start[k] = start[k] + len2 - len1;
+        }
+        double tmp = sol->bin_load[i1];
+        sol->bin_load[i1] = sol->bin_load[i2];
+        sol->bin_load[i2] = tmp;
+        for (size_t i = start[i1]; i < start[i1 + 1]; i++) {
+                sol->item_bin[sol->items[i]] = i1;
+        }
+        for (size_t i = start[i2]; i < start[i2 + 1]; i++) {
+                sol->item_bin[sol->items[i]] = i2;
+        }
+}
+void solution_regroup(struct solution *restrict sol,
+                      int num_bins,
+                      size_t inst_sz,
+                      const size_t *restrict perm) {
+        solution_group(sol, num_bins, inst_sz, perm);
 }
 
+void solution_first_fit_select(enum first_fit_impl impl) {
+        atomic_store_explicit(&first_fit_impl, impl, memory_order_relaxed);
+}
+size_t solution_first_fit_count(void) {
+        return atomic_load_explicit(&first_fit_count, memory_order_relaxed);
+}
+static enum first_fit_impl first_fit_selected(void) {
+        return atomic_load_explicit(&first_fit_impl, memory_order_relaxed);
+}
 void solution_first_fit(struct solution *restrict sol,
                         const double *restrict prob_inst,
                         size_t inst_sz,
                         const size_t *restrict perm,
                         double bin_cap) {
-        if (sol->num_bins > 0) {
-                solution_destroy(*sol);
-                solution_init(sol);
+        solution_first_fit_with(first_fit_selected(), sol, prob_inst,
+                                inst_sz, perm, bin_cap);
+}
+void solution_first_fit_with(enum first_fit_impl impl,
+                             struct solution *restrict sol,
+                             const double *restrict prob_inst,
+                             size_t inst_sz,
+                             const size_t *restrict perm,
+                             double bin_cap) {
+        if (sol->cap < inst_sz) {
+                solution_reserve(sol, inst_sz);
         }
-        for (size_t i = 0; i < inst_sz; i++) {
-                int j = 0;
-                for (; j < sol->num_bins; j++) {
-                        if (sol->bins[j].item_sum + prob_inst[perm[i]]
-                            <= bin_cap) {
-                                bin_add(sol->bins + j, perm[i], prob_inst);
-                                break;
-                        }
-                }
-                if (j == sol->num_bins) {
-                        struct bin tmp;
-                        bin_init(&tmp);
-                        bin_add(&tmp, perm[i], prob_inst);
-                        solution_add(sol, tmp);
-                }
+        const int num_bins = pack(impl, sol, prob_inst, inst_sz, perm,
+                                  bin_cap, 0, 0, NULL);
+        solution_group(sol, num_bins, inst_sz, perm);
+}
+
+void ff_checkpoints_init(struct ff_checkpoints *restrict cp) {
+        *cp = (struct ff_checkpoints){.inst_sz = 0,
+                                      .interval = 0,
+                                      .num = 0,
+                                      .num_bins = NULL,
+                                      .loads = NULL};
+}
+void ff_checkpoints_destroy(struct ff_checkpoints cp) {
+        free(cp.num_bins);
+        free(cp.loads);
+}
+void ff_checkpoints_invalidate(struct ff_checkpoints *restrict cp) {
+        cp->num = 0;
+}
+void ff_checkpoints_copy_prefix(struct ff_checkpoints *restrict dest,
+                                const struct ff_checkpoints *restrict src,
+                                size_t pos) {
+        if (src->num == 0) {
+                return;
+        }
+        checkpoints_reserve(dest, src->inst_sz);
+        size_t last = pos / src->interval;
+        if (last >= src->num) {
+                last = src->num - 1;
+        }
+        for (size_t c = 0; c <= last; c++) {
+                checkpoint_record(dest, c, checkpoint_loads(src, c),
+                                  src->num_bins[c]);
+        }
+}
+void solution_first_fit_record(struct solution *restrict sol,
+                               struct ff_checkpoints *restrict cp,
+                               const double *restrict prob_inst,
+                               size_t inst_sz,
+                               const size_t *restrict perm,
+                               double bin_cap) {
+        if (sol->cap < inst_sz) {
+                solution_reserve(sol, inst_sz);
+        }
+        checkpoints_reserve(cp, inst_sz);
+        const int num_bins = pack(first_fit_selected(), sol, prob_inst,
+                                  inst_sz, perm, bin_cap, 0, 0, cp);
+        cp->num = ((inst_sz - 1) / cp->interval) + 1;
+        solution_group(sol, num_bins, inst_sz, perm);
+}
+void solution_first_fit_resume(struct solution *restrict sol,
+                               struct ff_checkpoints *restrict dest_cp,
+                               const struct solution base,
+                               const struct ff_checkpoints *restrict cp,
+                               const double *restrict prob_inst,
+                               size_t inst_sz,
+                               const size_t *restrict perm,
+                               size_t first_changed,
+                               double bin_cap) {
+        if ((cp->num == 0) || (cp->inst_sz != inst_sz)) {
+                solution_first_fit_record(sol, dest_cp, prob_inst, inst_sz,
+                                          perm, bin_cap);
+                return;
+        }
+        if (sol->cap < inst_sz) {
+                solution_reserve(sol, inst_sz);
+        }
+        checkpoints_reserve(dest_cp, inst_sz);
+        size_t c = first_changed / cp->interval;
+        if (c >= cp->num) {
+                c = cp->num - 1;
+        }
+        /* items before the checkpoint sit where they did in base */
+        const int num_bins = cp->num_bins[c];
+        memcpy(sol->bin_load, checkpoint_loads(cp, c),
+               num_bins * sizeof(*sol->bin_load));
+        if (sol->item_bin != base.item_bin) {
+                memcpy(sol->item_bin, base.item_bin,
+                       inst_sz * sizeof(*sol->item_bin));
         }
+        const int new_num_bins = pack(first_fit_selected(), sol, prob_inst,
+                                      inst_sz, perm, bin_cap,
+                                      c * cp->interval,
+                                      num_bins, dest_cp);
+        dest_cp->num = ((inst_sz - 1) / dest_cp->interval) + 1;
+        solution_group(sol, new_num_bins, inst_sz, perm);
 }
 size_t *solution_reverse_first_fit(struct solution sol,
                                    size_t perm_sz) {
         size_t *perm = malloc(perm_sz * sizeof(*perm));
-        size_t *cur_pos = perm;
-        for (int i = 0; i < sol.num_bins; i++) {
-                cur_pos += bin_rff(sol.bins[i], cur_pos);
+        if (perm == NULL) {
+                abort();
         }
+        solution_reverse_first_fit_into(sol, perm);
         return perm;
 }
+void solution_reverse_first_fit_into(struct solution sol,
+                                     size_t *restrict perm) {
+        memcpy(perm, sol.items, sol.num_items * sizeof(*perm));
+}
 void solution_print(struct solution sol,
                     FILE *restrict out) {
         for (int i = 0; i < sol.num_bins; i++) {
                 fprintf(out, "bin %d: ", i);
-                bin_print(sol.bins[i], out);
+                bin_print(solution_bin(sol, i), out);
                 fputc('\n', out);
         }
 }
@@ -124,15 +395,504 @@ double solution_eval(struct solution sol,
         const double mul = 1.0 / (bin_cap * bin_cap * sol.num_bins);
         double sum = 0;
         for (int i = 0; i < sol.num_bins; i++) {
-                sum += (sol.bins[i].item_sum * sol.bins[i].item_sum);
+                sum += (sol.bin_load[i] * sol.bin_load[i]);
         }
         return sum * mul;
 }
 
-static int bin_rff(struct bin bin,
-                   size_t *restrict dest_perm) {
-        for (int i = 0; i < bin.num_items; i++) {
-                dest_perm[i] = bin.item_indices[i];
+#define NO_ITEM SIZE_MAX
+void move_eval_init(struct move_eval *restrict me,
+                    const struct solution *sol,
+                    const double *prob_inst,
+                    size_t inst_sz,
+                    double bin_cap) {
+        me->sol = sol;
+        me->prob_inst = prob_inst;
+        me->bin_cap = bin_cap;
+        me->ii = int_inst_find(prob_inst, inst_sz, bin_cap);
+        double sum = 0;
+        for (int i = 0; i < sol->num_bins; i++) {
+                sum += (sol->bin_load[i] * sol->bin_load[i]);
+        }
+        me->sq_sum = sum;
+        me->fitness = sum * (1.0 / (bin_cap * bin_cap * sol->num_bins));
+}
+struct move_delta move_eval_relocate(const struct move_eval *me,
+                                     size_t item,
+                                     int to) {
+        const struct solution *sol = me->sol;
+        const int from = sol->item_bin[item];
+        if (from == to) {
+                return (struct move_delta){.fits = true};
+        }
+        bool fits = true;
+        const double from_load = load_after(me, from, item, NO_ITEM, &fits);
+        const double to_load = load_after(me, to, NO_ITEM, item, &fits);
+        const bool empties = sol->bin_start[from + 1] - sol->bin_start[from]
+                             == 1;
+        return move_delta(me, from, from_load, to, to_load,
+                          (to == sol->num_bins) - empties, fits);
+}
+struct move_delta move_eval_swap(const struct move_eval *me,
+                                 size_t item1,
+                                 size_t item2) {
+        const int bin1 = me->sol->item_bin[item1];
+        const int bin2 = me->sol->item_bin[item2];
+        if (bin1 == bin2) {
+                return (struct move_delta){.fits = true};
+        }
+        bool fits = true;
+        const double load1 = load_after(me, bin1, item1, item2, &fits);
+        const double load2 = load_after(me, bin2, item2, item1, &fits);
+        return move_delta(me, bin1, load1, bin2, load2, 0, fits);
+}
+struct move_delta move_eval_merge(const struct move_eval *me,
+                                  int from,
+                                  int to) {
+        if (from == to) {
+                return (struct move_delta){.fits = true};
+        }
+        const double *load = me->sol->bin_load;
+        double to_load;
+        bool fits;
+        if (me->ii != NULL) {
+                const int64_t sum = nearbyint(load[from] * me->ii->scale)
+                                    + nearbyint(load[to] * me->ii->scale);
+                fits = sum <= me->ii->cap;
+                to_load = sum / me->ii->scale;
+        } else {
+                to_load = load[from] + load[to];
+                fits = to_load <= me->bin_cap;
+        }
+        return move_delta(me, from, 0.0, to, to_load, -1, fits);
+}
+
+/* items, bin_start (one longer), bin_load, item_bin */
+static size_t block_size(size_t cap) {
+        return (cap * sizeof(size_t)) + ((cap + 1) * sizeof(size_t))
+               + (cap * sizeof(double)) + (cap * sizeof(int));
+}
+static void solution_layout(struct solution *restrict sol,
+                            void *block,
+                            size_t cap) {
+        sol->cap = cap;
+        sol->items = block;
+        sol->bin_start = sol->items + cap;
+        sol->bin_load = (double *)(sol->bin_start + cap + 1);
+        sol->item_bin = (int *)(sol->bin_load + cap);
+}
+/* grows sol to cap, keeping its contents */
+static void solution_reserve(struct solution *restrict sol,
+                             size_t cap) {
+        struct solution old = *sol;
+        void *block = malloc(block_size(cap));
+        if (block == NULL) {
+                abort();
+        }
+        solution_layout(sol, block, cap);
+        sol->bin_start[0] = 0;
+        if (old.cap > 0) {
+                memcpy(sol->items, old.items,
+                       old.num_items * sizeof(*sol->items));
+                memcpy(sol->bin_start, old.bin_start,
+                       (old.num_bins + 1) * sizeof(*sol->bin_start));
+                memcpy(sol->bin_load, old.bin_load,
+                       old.num_bins * sizeof(*sol->bin_load));
+                memcpy(sol->item_bin, old.item_bin,
+                       old.cap * sizeof(*sol->item_bin));
+        }
+        solution_destroy(old);
+}
+/* The packers place perm[from] onwards on top of the num_bins bins
+ * already in bin_load, fill in item_bin and return the number of bins;
+ * solution_group then lays out items and bin_start. If cp is not NULL the
+ * bin loads are recorded at every checkpoint from `from` on. Instances
+ * registered with int_inst_register are packed in integer units. */
+static int pack(enum first_fit_impl impl,
+                struct solution *restrict sol,
+                const double *restrict prob_inst,
+                size_t inst_sz,
+                const size_t *restrict perm,
+                double bin_cap,
+                size_t from,
+                int num_bins,
+                struct ff_checkpoints *restrict cp) {
+        atomic_fetch_add_explicit(&first_fit_count, 1, memory_order_relaxed);
+        const struct int_inst *ii = int_inst_find(prob_inst, inst_sz,
+                                                  bin_cap);
+        if (ii != NULL) {
+                return pack_int(impl, sol, ii, perm, from, num_bins, cp);
+        }
+        switch (impl) {
+                case FIRST_FIT_TREE:
+                        return pack_tree(sol, prob_inst, inst_sz, perm,
+                                         bin_cap, from, num_bins, cp);
+                case FIRST_FIT_LINEAR:
+                default:
+                        return pack_linear(sol, prob_inst, inst_sz, perm,
+                                           bin_cap, from, num_bins, cp);
+        }
+}
+static int pack_linear(struct solution *restrict sol,
+                       const double *restrict prob_inst,
+                       size_t inst_sz,
+                       const size_t *restrict perm,
+                       double bin_cap,
+                       size_t from,
+                       int num_bins,
+                       struct ff_checkpoints *restrict cp) {
+        const ff_scan_dbl_func scan = ff_scan_dbl();
+        double *restrict load = sol->bin_load;
+        int *restrict item_bin = sol->item_bin;
+        for (size_t i = from; i < inst_sz; i++) {
+                if ((cp != NULL) && (i % cp->interval == 0)) {
+                        checkpoint_record(cp, i / cp->interval, load,
+                                          num_bins);
+                }
+                const double item = prob_inst[perm[i]];
+                const int j = scan(load, num_bins, item, bin_cap);
+                if (j == num_bins) {
+                        load[num_bins] = 0.0;
+                        num_bins++;
+                }
+                load[j] += item;
+                item_bin[perm[i]] = j;
+        }
+        return num_bins;
+}
+/* Complete binary tree over inst_sz bin slots holding the minimum load
+ * below each node, leaves at tree[leaves + j]. Unopened bins sit at load
+ * 0, so the first unopened bin is found like any other. Because adding a
+ * size is monotonic, a subtree holds a bin that fits exactly when its
+ * minimum load plus the size fits, which keeps the result identical to
+ * the linear scan. */
+static int pack_tree(struct solution *restrict sol,
+                     const double *restrict prob_inst,
+                     size_t inst_sz,
+                     const size_t *restrict perm,
+                     double bin_cap,
+                     size_t from,
+                     int num_bins,
+                     struct ff_checkpoints *restrict cp) {
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        size_t leaves = 1;
+        while (leaves < inst_sz) {
+                leaves *= 2;
+        }
+        double *restrict tree = arena_alloc(arena,
+                                            2 * leaves * sizeof(*tree));
+        double *restrict load = sol->bin_load;
+        int *restrict item_bin = sol->item_bin;
+        memcpy(tree + leaves, load, num_bins * sizeof(*tree));
+        memset(tree + leaves + num_bins, 0,
+               (leaves - num_bins) * sizeof(*tree));
+        for (size_t node = leaves - 1; node > 0; node--) {
+                const double left = tree[2 * node];
+                const double right = tree[(2 * node) + 1];
+                tree[node] = (left < right) ? left : right;
+        }
+
+        for (size_t i = from; i < inst_sz; i++) {
+                if ((cp != NULL) && (i % cp->interval == 0)) {
+                        checkpoint_record(cp, i / cp->interval, load,
+                                          num_bins);
+                }
+                const double item = prob_inst[perm[i]];
+                size_t node = 1;
+                if (tree[node] + item <= bin_cap) {
+                        while (node < leaves) {
+                                node *= 2;
+                                if (!(tree[node] + item <= bin_cap)) {
+                                        node++;
+                                }
+                        }
+                } else {
+                        /* fits nowhere, not even alone */
+                        node = leaves + num_bins;
+                }
+                const int j = node - leaves;
+                if (j == num_bins) {
+                        load[num_bins] = 0.0;
+                        num_bins++;
+                }
+                load[j] += item;
+                item_bin[perm[i]] = j;
+
+                /* loads only grow, so stop once a minimum stays put */
+                tree[node] = load[j];
+                for (node /= 2; node > 0; node /= 2) {
+                        const double left = tree[2 * node];
+                        const double right = tree[(2 * node) + 1];
+                        const double min = (left < right) ? left : right;
+                        if (tree[node] == min) {
+                                break;
+                        }
+                        tree[node] = min;
+                }
+        }
+
+        arena_release(arena, mark);
+        return num_bins;
+}
+/* Integer loads live in the arena for the length of the decode and are
+ * only turned back into bin_load at checkpoints and at the end. Each
+ * bin_load is then the double nearest to the exact load, which in turn
+ * converts back to the same integer when a decode resumes. */
+static int pack_int(enum first_fit_impl impl,
+                    struct solution *restrict sol,
+                    const struct int_inst *restrict ii,
+                    const size_t *restrict perm,
+                    size_t from,
+                    int num_bins,
+                    struct ff_checkpoints *restrict cp) {
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        uint32_t *restrict load = arena_alloc(arena,
+                                              ii->inst_sz * sizeof(*load));
+        for (int j = 0; j < num_bins; j++) {
+                load[j] = nearbyint(sol->bin_load[j] * ii->scale);
+        }
+        switch (impl) {
+                case FIRST_FIT_TREE:
+                        num_bins = pack_tree_int(sol, load, ii, perm, from,
+                                                 num_bins, cp);
+                        break;
+                case FIRST_FIT_LINEAR:
+                default:
+                        num_bins = pack_linear_int(sol, load, ii, perm, from,
+                                                   num_bins, cp);
+                        break;
+        }
+        loads_from_int(sol->bin_load, load, num_bins, ii->scale);
+        arena_release(arena, mark);
+        return num_bins;
+}
+static int pack_linear_int(struct solution *restrict sol,
+                           uint32_t *restrict load,
+                           const struct int_inst *restrict ii,
+                           const size_t *restrict perm,
+                           size_t from,
+                           int num_bins,
+                           struct ff_checkpoints *restrict cp) {
+        const ff_scan_int_func scan = ff_scan_int();
+        const uint32_t *restrict size = ii->sizes;
+        const uint32_t bin_cap = ii->cap;
+        int *restrict item_bin = sol->item_bin;
+        for (size_t i = from; i < ii->inst_sz; i++) {
+                if ((cp != NULL) && (i % cp->interval == 0)) {
+                        loads_from_int(sol->bin_load, load, num_bins,
+                                       ii->scale);
+                        checkpoint_record(cp, i / cp->interval,
+                                          sol->bin_load, num_bins);
+                }
+                const uint32_t item = size[perm[i]];
+                /* an item larger than a bin fits nowhere */
+                const int j = (item <= bin_cap)
+                              ? scan(load, num_bins, bin_cap - item)
+                              : num_bins;
+                if (j == num_bins) {
+                        load[num_bins] = 0;
+                        num_bins++;
+                }
+                load[j] += item;
+                item_bin[perm[i]] = j;
+        }
+        return num_bins;
+}
+/* pack_tree over integer loads; see there */
+static int pack_tree_int(struct solution *restrict sol,
+                         uint32_t *restrict load,
+                         const struct int_inst *restrict ii,
+                         const size_t *restrict perm,
+                         size_t from,
+                         int num_bins,
+                         struct ff_checkpoints *restrict cp) {
+        const uint32_t *restrict size = ii->sizes;
+        const uint32_t bin_cap = ii->cap;
+        int *restrict item_bin = sol->item_bin;
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        size_t leaves = 1;
+        while (leaves < ii->inst_sz) {
+                leaves *= 2;
+        }
+        uint32_t *restrict tree = arena_alloc(arena,
+                                              2 * leaves * sizeof(*tree));
+        memcpy(tree + leaves, load, num_bins * sizeof(*tree));
+        memset(tree + leaves + num_bins, 0,
+               (leaves - num_bins) * sizeof(*tree));
+        for (size_t node = leaves - 1; node > 0; node--) {
+                const uint32_t left = tree[2 * node];
+                const uint32_t right = tree[(2 * node) + 1];
+                tree[node] = (left < right) ? left : right;
+        }
+
+        for (size_t i = from; i < ii->inst_sz; i++) {
+                if ((cp != NULL) && (i % cp->interval == 0)) {
+                        loads_from_int(sol->bin_load, load, num_bins,
+                                       ii->scale);
+                        checkpoint_record(cp, i / cp->interval,
+                                          sol->bin_load, num_bins);
+                }
+                const uint32_t item = size[perm[i]];
+                size_t node = 1;
+                if (tree[node] + item <= bin_cap) {
+                        while (node < leaves) {
+                                node *= 2;
+                                if (tree[node] + item > bin_cap) {
+                                        node++;
+                                }
+                        }
+                } else {
+                        node = leaves + num_bins;
+                }
+                const int j = node - leaves;
+                if (j == num_bins) {
+                        load[num_bins] = 0;
+                        num_bins++;
+                }
+                load[j] += item;
+                item_bin[perm[i]] = j;
+
+                tree[node] = load[j];
+                for (node /= 2; node > 0; node /= 2) {
+                        const uint32_t left = tree[2 * node];
+                        const uint32_t right = tree[(2 * node) + 1];
+                        const uint32_t min = (left < right) ? left : right;
+                        if (tree[node] == min) {
+                                break;
+                        }
+                        tree[node] = min;
+                }
+        }
+
+        arena_release(arena, mark);
+        return num_bins;
+}
+static void loads_from_int(double *restrict load,
+                           const uint32_t *restrict int_load,
+                           int num_bins,
+                           double scale) {
+        for (int j = 0; j < num_bins; j++) {
+                load[j] = int_load[j] / scale;
+        }
+}
+static double load_after(const struct move_eval *me,
+                         int bin,
+                         size_t out,
+                         size_t in,
+                         bool *fits) {
+        const bool is_open = bin < me->sol->num_bins;
+        if (me->ii != NULL) {
+                const struct int_inst *ii = me->ii;
+                int64_t load = (is_open)
+                               ? nearbyint(me->sol->bin_load[bin] * ii->scale)
+                               : 0;
+                load += (in != NO_ITEM) ? ii->sizes[in] : 0;
+                load -= (out != NO_ITEM) ? ii->sizes[out] : 0;
+                *fits = *fits && (load <= ii->cap);
+                return load / ii->scale;
+        }
+        double load = (is_open) ? me->sol->bin_load[bin] : 0.0;
+        load += (in != NO_ITEM) ? me->prob_inst[in] : 0.0;
+        load -= (out != NO_ITEM) ? me->prob_inst[out] : 0.0;
+        *fits = *fits && (load <= me->bin_cap);
+        return load;
+}
+static struct move_delta move_delta(const struct move_eval *me,
+                                    int bin1,
+                                    double load1,
+                                    int bin2,
+                                    double load2,
+                                    int num_bins_delta,
+                                    bool fits) {
+        const double *load = me->sol->bin_load;
+        const int num_bins = me->sol->num_bins;
+        double sq_sum = me->sq_sum + (load1 * load1) + (load2 * load2);
+        if (bin1 < num_bins) {
+                sq_sum -= load[bin1] * load[bin1];
+        }
+        if (bin2 < num_bins) {
+                sq_sum -= load[bin2] * load[bin2];
+        }
+        const double cap = me->bin_cap;
+        const double fitness = sq_sum * (1.0 / (cap * cap
+                                                * (num_bins
+                                                   + num_bins_delta)));
+        return (struct move_delta){.fitness = fitness - me->fitness,
+                                   .num_bins = num_bins_delta,
+                                   .fits = fits};
+}
+/* stable counting sort of perm by bin; start[j] serves as bin j's write
+ * cursor and ends up at the start of bin j + 1 */
+static void solution_group(struct solution *restrict sol,
+                           int num_bins,
+                           size_t inst_sz,
+                           const size_t *restrict perm) {
+        size_t *restrict start = sol->bin_start;
+        const int *restrict item_bin = sol->item_bin;
+        memset(start, 0, (num_bins + 1) * sizeof(*start));
+        for (size_t i = 0; i < inst_sz; i++) {
+                start[item_bin[perm[i]] + 1]++;
+        }
+        for (int j = 1; j <= num_bins; j++) {
+                start[j] += start[j - 1];
+        }
+        for (size_t i = 0; i < inst_sz; i++) {
+                sol->items[start[item_bin[perm[i]]]++] = perm[i];
+        }
+        memmove(start + 1, start, num_bins * sizeof(*start));
+        start[0] = 0;
+
+        sol->num_bins = num_bins;
+        sol->num_items = inst_sz;
+}
+/* checkpoint c is taken before position c * interval, where there are
+ * at most that many bins, so the loads of checkpoint c start at
+ * interval * (0 + 1 + ... + (c - 1)) */
+static double *checkpoint_loads(const struct ff_checkpoints *cp,
+                                size_t c) {
+        return cp->loads + (cp->interval * ((c * (c - 1)) / 2));
+}
+static void checkpoint_record(struct ff_checkpoints *restrict cp,
+                              size_t c,
+                              const double *restrict load,
+                              int num_bins) {
+        cp->num_bins[c] = num_bins;
+        memcpy(checkpoint_loads(cp, c), load, num_bins * sizeof(*load));
+}
+/* aim for about CHECKPOINTS checkpoints, but no closer than
+ * MIN_CHECKPOINT_INTERVAL items apart */
+static void checkpoints_reserve(struct ff_checkpoints *restrict cp,
+                                size_t inst_sz) {
+        if (cp->inst_sz == inst_sz) {
+                return;
+        }
+        ff_checkpoints_destroy(*cp);
+        size_t interval = inst_sz / CHECKPOINTS;
+        if (interval < MIN_CHECKPOINT_INTERVAL) {
+                interval = MIN_CHECKPOINT_INTERVAL;
+        }
+        const size_t num = ((inst_sz - 1) / interval) + 1;
+        *cp = (struct ff_checkpoints){.inst_sz = inst_sz,
+                                      .interval = interval,
+                                      .num = 0,
+                                      .num_bins = malloc(num
+                                                         * sizeof(int)),
+                                      .loads = malloc(interval
+                                                      * ((num * (num - 1))
+                                                         / 2 + 1)
+                                                      * sizeof(double))};
+        if ((cp->num_bins == NULL) || (cp->loads == NULL)) {
+                abort();
+        }
+}
+static void items_reverse(size_t *items,
+                          size_t len) {
+        for (size_t i = 0; i < len / 2; i++) {
+                size_t tmp = items[i];
+                items[i] = items[len - 1 - i];
+                items[len - 1 - i] = tmp;
         }
-        return bin.num_items;
 }
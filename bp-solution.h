@@ -3,6 +3,9 @@
 
 #include <stddef.h>
 #include <stdio.h>
+#include <stdbool.h>
+
+struct int_inst;
 
 struct bin {
         double item_sum;
@@ -18,28 +21,168 @@ void bin_copy(struct bin *restrict dest,
 void bin_print(struct bin bin,
                FILE *restrict out);
 
+/* Flat (CSR-style) packing. Bin i holds
+ * items[bin_start[i]] .. items[bin_start[i + 1] - 1], so items read in
+ * order is the solution's reverse-first-fit permutation. bin_load[i] is
+ * the sum of the sizes in bin i; the residual capacity of a bin is
+ * bin_cap - bin_load[i], kept implicit so that loads are summed in exactly
+ * the order first-fit adds them. item_bin maps an item index to its bin.
+ * All four arrays live in one block laid out for cap items, so copying a
+ * solution is a single memcpy; the block is kept across decodes and only
+ * grows. */
 struct solution {
         int num_bins;
-        struct bin *bins;
+        size_t num_items;
+        size_t cap;
+        size_t *items;
+        size_t *bin_start;
+        double *bin_load;
+        int *item_bin;
 };
 void solution_init(struct solution *restrict sol);
+/* takes ownership of bin.item_indices */
 void solution_add(struct solution *restrict sol,
                   struct bin bin);
 void solution_destroy(struct solution sol);
+/* empties sol but keeps its storage */
+void solution_clear(struct solution *restrict sol);
+/* dest is assumed uninitialized */
 void solution_copy(struct solution *restrict dest,
                    const struct solution src);
+/* dest must be initialized; reuses its storage */
+void solution_assign(struct solution *restrict dest,
+                     const struct solution src);
+/* view of bin i; item_indices points into sol and is invalidated by any
+ * change to it */
+struct bin solution_bin(struct solution sol,
+                        int i);
+/* exchanges the positions of two bins, keeping each bin's item order */
+void solution_swap_bins(struct solution *restrict sol,
+                        int i1,
+                        int i2);
+/* Lays out items and bin_start anew once item_bin puts each of inst_sz
+ * items in one of num_bins bins, none of them empty, with items in each
+ * bin in their order in perm; bin_load is left to the caller. perm must
+ * not point into sol. */
+void solution_regroup(struct solution *restrict sol,
+                      int num_bins,
+                      size_t inst_sz,
+                      const size_t *restrict perm);
 
+/* Implementations of first-fit; all produce the same packing.
+ * FIRST_FIT_LINEAR scans the open bins for every item, O(n * bins), with
+ * the vector kernel chosen in ff-scan.h;
+ * FIRST_FIT_TREE descends a tree of minimum bin loads, O(n log n). */
+enum first_fit_impl {
+        FIRST_FIT_LINEAR,
+        FIRST_FIT_TREE
+};
+/* selects the implementation used by solution_first_fit for the whole
+ * process; FIRST_FIT_LINEAR until changed */
+void solution_first_fit_select(enum first_fit_impl impl);
+/* decodes by solution_first_fit and its variants, full or resumed, since
+ * the process started, counting every run and thread together */
+size_t solution_first_fit_count(void);
 void solution_first_fit(struct solution *restrict sol,
                         const double *restrict prob_inst,
                         size_t inst_sz,
                         const size_t *restrict perm,
                         double bin_cap);
+void solution_first_fit_with(enum first_fit_impl impl,
+                             struct solution *restrict sol,
+                             const double *restrict prob_inst,
+                             size_t inst_sz,
+                             const size_t *restrict perm,
+                             double bin_cap);
+/* Snapshots of the bin loads first-fit had built up before every
+ * interval-th position of a permutation. A permutation that matches the
+ * recorded one up to some position can resume decoding from the last
+ * snapshot before it instead of starting over. */
+struct ff_checkpoints {
+        size_t inst_sz;
+        size_t interval;
+        /* number of valid checkpoints; 0 when nothing is recorded */
+        size_t num;
+        int *num_bins;
+        double *loads;
+};
+void ff_checkpoints_init(struct ff_checkpoints *restrict cp);
+void ff_checkpoints_destroy(struct ff_checkpoints cp);
+/* marks cp as no longer matching any permutation */
+void ff_checkpoints_invalidate(struct ff_checkpoints *restrict cp);
+/* copies the checkpoints of src at or before position pos into dest;
+ * together with solution_first_fit_resume this completes dest */
+void ff_checkpoints_copy_prefix(struct ff_checkpoints *restrict dest,
+                                const struct ff_checkpoints *restrict src,
+                                size_t pos);
+/* solution_first_fit that also records checkpoints into cp */
+void solution_first_fit_record(struct solution *restrict sol,
+                               struct ff_checkpoints *restrict cp,
+                               const double *restrict prob_inst,
+                               size_t inst_sz,
+                               const size_t *restrict perm,
+                               double bin_cap);
+/* Decodes perm into sol, where base and cp were recorded from a
+ * permutation equal to perm before position first_changed. Checkpoints
+ * after the one resumed from are recorded into dest_cp; the earlier ones
+ * are left alone (see ff_checkpoints_copy_prefix). Falls back to a full
+ * decode if cp is empty or of another size. */
+void solution_first_fit_resume(struct solution *restrict sol,
+                               struct ff_checkpoints *restrict dest_cp,
+                               const struct solution base,
+                               const struct ff_checkpoints *restrict cp,
+                               const double *restrict prob_inst,
+                               size_t inst_sz,
+                               const size_t *restrict perm,
+                               size_t first_changed,
+                               double bin_cap);
 size_t *solution_reverse_first_fit(struct solution sol,
                                    size_t perm_sz);
+void solution_reverse_first_fit_into(struct solution sol,
+                                     size_t *restrict perm);
 void solution_print(struct solution sol,
                     FILE *restrict out);
 
 double solution_eval(struct solution sol,
                      double bin_cap);
 
+/* Weighs moves on a decoded solution in constant time each, so a local
+ * search can try many before making one. sol must stay unchanged while
+ * moves are weighed against it. A move reports how solution_eval and the
+ * number of bins would change and whether the bins it touches would
+ * still hold their items, checked in exact units for an instance
+ * registered with int-inst.h. */
+struct move_eval {
+        const struct solution *sol;
+        const double *prob_inst;
+        double bin_cap;
+        /* NULL unless the instance was registered */
+        const struct int_inst *ii;
+        /* sum of the squared bin loads, and solution_eval of sol */
+        double sq_sum;
+        double fitness;
+};
+struct move_delta {
+        double fitness;
+        int num_bins;
+        bool fits;
+};
+void move_eval_init(struct move_eval *restrict me,
+                    const struct solution *sol,
+                    const double *prob_inst,
+                    size_t inst_sz,
+                    double bin_cap);
+/* item moves to bin to, or to a bin of its own if to is sol->num_bins */
+struct move_delta move_eval_relocate(const struct move_eval *me,
+                                     size_t item,
+                                     int to);
+/* item1 and item2 trade bins */
+struct move_delta move_eval_swap(const struct move_eval *me,
+                                 size_t item1,
+                                 size_t item2);
+/* every item of bin from moves to bin to */
+struct move_delta move_eval_merge(const struct move_eval *me,
+                                  int from,
+                                  int to);
+
 #endif /* !BP_SOLUTION_H */
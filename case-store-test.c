@@ -0,0 +1,155 @@
+#include "case-store.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_CASES       3
+#define CASE_SZ         10
+
+/* a store file holding NUM_CASES cases, in a malloc'd buffer */
+static unsigned char *write_store(size_t *len);
+/* case_store_open of the bytes given, through a file at a fresh path,
+ * finding what it can in the store on success; returns the open's
+ * result */
+static int open_bytes(const void *bytes,
+                      size_t len,
+                      size_t *num_found);
+/* opens a copy of store with edit applied and prints whether it was
+ * rejected */
+static void check_edit(const unsigned char *store,
+                       size_t len,
+                       const char *what,
+                       void (*edit)(struct case_header *,
+                                    struct case_block *));
+
+static void edit_block_past_end(struct case_header *header,
+                                struct case_block *block) {
+        header->first_block_at = header->size;
+        header->last_block_at = header->size;
+}
+static void edit_sizes_past_end(struct case_header *header,
+                                struct case_block *block) {
+        block->entries[1].sizes_at = (header->size + 7) & ~(uint64_t)7;
+}
+static void edit_huge(struct case_header *header,
+                      struct case_block *block) {
+        block->entries[2].inst_sz = UINT64_MAX / 2;
+}
+static void edit_cycle(struct case_header *header,
+                       struct case_block *block) {
+        block->next_at = header->first_block_at;
+}
+static void edit_num(struct case_header *header,
+                     struct case_block *block) {
+        block->num = CASE_BLOCK_ENTRIES + 1;
+}
+static void edit_num_cases(struct case_header *header,
+                           struct case_block *block) {
+        header->num_cases++;
+}
+
+int main(int argc, char **argv) {
+        size_t len;
+        unsigned char *store = write_store(&len);
+        size_t num_found = 0;
+        const int ret = open_bytes(store, len, &num_found);
+        printf("intact: open %d, found %zu\n", ret, num_found);
+        printf("truncated: open %d\n",
+               open_bytes(store, sizeof(struct case_header), &num_found));
+        check_edit(store, len, "block past the end", edit_block_past_end);
+        check_edit(store, len, "sizes past the end", edit_sizes_past_end);
+        check_edit(store, len, "huge size", edit_huge);
+        check_edit(store, len, "block chained to itself", edit_cycle);
+        check_edit(store, len, "overfull block", edit_num);
+        check_edit(store, len, "wrong case count", edit_num_cases);
+        free(store);
+        return 0;
+}
+
+static unsigned char *write_store(size_t *len) {
+        char path[] = "/tmp/case-store-test-XXXXXX";
+        const int fd = mkstemp(path);
+        if (fd < 0) {
+                abort();
+        }
+        close(fd);
+        struct case_store cases;
+        if (case_store_open(&cases, path) != 0) {
+                abort();
+        }
+        double prob_inst[CASE_SZ];
+        size_t perm[CASE_SZ];
+        for (size_t c = 0; c < NUM_CASES; c++) {
+                for (size_t i = 0; i < CASE_SZ; i++) {
+                        prob_inst[i] = (double)((i * 7 + c) % CASE_SZ + 1);
+                        perm[i] = i;
+                }
+                case_store_add(&cases, prob_inst, CASE_SZ, 2 * CASE_SZ,
+                               perm, CASE_SZ / 2);
+        }
+        case_store_close(&cases);
+
+        FILE *file = fopen(path, "rb");
+        if ((file == NULL) || (fseek(file, 0, SEEK_END) != 0)) {
+                abort();
+        }
+        *len = ftell(file);
+        unsigned char *bytes = malloc(*len);
+        if (bytes == NULL) {
+                abort();
+        }
+        rewind(file);
+        if (fread(bytes, 1, *len, file) != *len) {
+                abort();
+        }
+        fclose(file);
+        unlink(path);
+        return bytes;
+}
+static int open_bytes(const void *bytes,
+                      size_t len,
+                      size_t *num_found) {
+        char path[] = "/tmp/case-store-test-XXXXXX";
+        const int fd = mkstemp(path);
+        if ((fd < 0) || (write(fd, bytes, len) != (ssize_t)len)) {
+                abort();
+        }
+        close(fd);
+        struct case_store cases;
+        const int ret = case_store_open(&cases, path);
+        if (ret == 0) {
+                double prob_inst[CASE_SZ];
+                size_t perm_bufs[NUM_CASES + 1][CASE_SZ];
+                size_t *perms[NUM_CASES + 1];
+                for (size_t i = 0; i < CASE_SZ; i++) {
+                        prob_inst[i] = (double)(i + 1);
+                }
+                for (size_t c = 0; c <= NUM_CASES; c++) {
+                        perms[c] = perm_bufs[c];
+                }
+                *num_found = case_store_find(&cases, prob_inst, CASE_SZ,
+                                             2 * CASE_SZ, NUM_CASES + 1,
+                                             perms);
+                case_store_close(&cases);
+        }
+        unlink(path);
+        return ret;
+}
+static void check_edit(const unsigned char *store,
+                       size_t len,
+                       const char *what,
+                       void (*edit)(struct case_header *,
+                                    struct case_block *)) {
+        unsigned char *copy = malloc(len);
+        if (copy == NULL) {
+                abort();
+        }
+        memcpy(copy, store, len);
+        struct case_header *header = (void *)copy;
+        edit(header, (void *)(copy + header->first_block_at));
+        size_t num_found = 0;
+        printf("%s: open %d\n", what, open_bytes(copy, len, &num_found));
+        free(copy);
+}
@@ -0,0 +1,464 @@
+#include "case-store.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BYTE_ORDER_MARK 0x01020304
+#define INITIAL_SIZE    ((size_t)1 << 16)
+#define REL_MAX         UINT16_MAX
+
+/* an item of the instance being laid onto, by relative size */
+struct rel_item {
+        uint16_t rel;
+        size_t index;
+};
+
+static struct case_header *store_header(struct case_store *store);
+static void store_init_header(struct case_store *store);
+/* whether the index of a store read from a file fits it: every block and
+ * every case's sizes within the bytes in use, and the blocks chained
+ * forward, as they are appended, from first_block_at to last_block_at */
+static bool store_check(const struct case_store *store);
+static bool store_check(const struct case_store *store) {
+        const struct case_header *header = (const void *)store->map;
+        const uint64_t size = header->size;
+        if ((size < sizeof(*header))
+            || ((header->first_block_at == 0)
+                != (header->last_block_at == 0))) {
+                return false;
+        }
+        uint64_t num_cases = 0;
+        uint64_t prev_at = 0;
+        uint64_t block_at = header->first_block_at;
+        while (block_at != 0) {
+                if ((block_at <= prev_at) || (block_at < sizeof(*header))
+                    || (block_at % 8 != 0) || (block_at > size)
+                    || (size - block_at < sizeof(struct case_block))) {
+                        return false;
+                }
+                const struct case_block *block = (const void *)(store->map
+                                                                + block_at);
+                if (block->num > CASE_BLOCK_ENTRIES) {
+                        return false;
+                }
+                for (uint64_t e = 0; e < block->num; e++) {
+                        const struct case_entry *entry = &block->entries[e];
+                        if ((entry->sizes_at < sizeof(*header))
+                            || (entry->sizes_at % 8 != 0)
+                            || (entry->sizes_at > size)
+                            || (entry->inst_sz > (size - entry->sizes_at)
+                                                 / sizeof(uint16_t))) {
+                                return false;
+                        }
+                }
+                num_cases += block->num;
+                prev_at = block_at;
+                block_at = block->next_at;
+        }
+        return (prev_at == header->last_block_at)
+               && (num_cases == header->num_cases);
+}
+static void store_lock(struct case_store *store,
+                       bool is_exclusive);
+static void store_unlock(struct case_store *store);
+/* maps all of the file, which another process may have grown */
+static void store_sync(struct case_store *store);
+/* room for sz more bytes at an 8-byte boundary, growing the store */
+static uint64_t store_reserve(struct case_store *store,
+                              size_t sz);
+static void store_grow(struct case_store *store,
+                       size_t min_sz);
+static uint16_t rel_size(double size,
+                         double bin_cap);
+static void signature(const double *prob_inst,
+                      size_t inst_sz,
+                      double bin_cap,
+                      float *sig);
+static double sig_distance(const float *sig1,
+                           size_t sz1,
+                           const float *sig2,
+                           size_t sz2);
+static int rel_item_cmp(const void *a,
+                        const void *b);
+/* the first unused position at or after pos, n if none; right holds
+ * n + 1 links */
+static size_t find_right(size_t *right,
+                         size_t pos);
+/* one more than the last unused position before pos, 0 if none */
+static size_t find_left(size_t *left,
+                        size_t pos);
+static void lay_case(const uint16_t *case_sizes,
+                     size_t case_sz,
+                     const struct rel_item *items,
+                     size_t inst_sz,
+                     size_t *right,
+                     size_t *left,
+                     size_t *perm);
+
+int case_store_open(struct case_store *store,
+                    const char *path) {
+        pthread_mutex_init(&store->lock, NULL);
+        if (path == NULL) {
+                store->fd = -1;
+                store->map_sz = INITIAL_SIZE;
+                store->map = calloc(1, store->map_sz);
+                if (store->map == NULL) {
+                        abort();
+                }
+                store_init_header(store);
+                return 0;
+        }
+        store->fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (store->fd < 0) {
+                pthread_mutex_destroy(&store->lock);
+                return -1;
+        }
+        store->map = NULL;
+        store->map_sz = 0;
+        flock(store->fd, LOCK_EX);
+        struct stat st;
+        if (fstat(store->fd, &st) != 0) {
+                goto fail;
+        }
+        const bool is_new = st.st_size == 0;
+        if (is_new && (ftruncate(store->fd, INITIAL_SIZE) != 0)) {
+                goto fail;
+        }
+        store_sync(store);
+        if (store->map == NULL) {
+                goto fail;
+        }
+        const struct case_header *header = store_header(store);
+        if (is_new) {
+                store_init_header(store);
+        } else if ((store->map_sz < sizeof(*header))
+                   || (memcmp(header->magic, CASE_MAGIC,
+                              sizeof(CASE_MAGIC)) != 0)
+                   || (header->version != CASE_VERSION)
+                   || (header->byte_order != BYTE_ORDER_MARK)
+                   || (header->size > store->map_sz)
+                   || !store_check(store)) {
+                goto fail;
+        }
+        flock(store->fd, LOCK_UN);
+        return 0;
+fail:
+        if (store->map != NULL) {
+                munmap(store->map, store->map_sz);
+        }
+        flock(store->fd, LOCK_UN);
+        close(store->fd);
+        pthread_mutex_destroy(&store->lock);
+        return -1;
+}
+void case_store_close(struct case_store *store) {
+        if (store->fd < 0) {
+                free(store->map);
+        } else {
+                munmap(store->map, store->map_sz);
+                close(store->fd);
+        }
+        pthread_mutex_destroy(&store->lock);
+}
+void case_store_add(struct case_store *store,
+                    const double *prob_inst,
+                    size_t inst_sz,
+                    double bin_cap,
+                    const size_t *perm,
+                    int num_bins) {
+        store_lock(store, true);
+        struct case_header *header = store_header(store);
+        uint64_t block_at = header->last_block_at;
+        if ((block_at == 0)
+            || (((struct case_block *)(store->map + block_at))->num
+                == CASE_BLOCK_ENTRIES)) {
+                const uint64_t new_at = store_reserve(store,
+                                                      sizeof(struct
+                                                             case_block));
+                header = store_header(store);
+                if (block_at == 0) {
+                        header->first_block_at = new_at;
+                } else {
+                        ((struct case_block *)(store->map + block_at))
+                                ->next_at = new_at;
+                }
+                header->last_block_at = new_at;
+                block_at = new_at;
+        }
+        const uint64_t sizes_at = store_reserve(store,
+                                                inst_sz * sizeof(uint16_t));
+        header = store_header(store);
+        uint16_t *sizes = (uint16_t *)(store->map + sizes_at);
+        for (size_t i = 0; i < inst_sz; i++) {
+                sizes[i] = rel_size(prob_inst[perm[i]], bin_cap);
+        }
+        struct case_block *block = (struct case_block *)(store->map
+                                                         + block_at);
+        struct case_entry *entry = &block->entries[block->num];
+        entry->inst_sz = inst_sz;
+        entry->sizes_at = sizes_at;
+        entry->num_bins = num_bins;
+        signature(prob_inst, inst_sz, bin_cap, entry->sig);
+        block->num++;
+        header->num_cases++;
+        store_unlock(store);
+}
+size_t case_store_find(struct case_store *store,
+                       const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap,
+                       size_t k,
+                       size_t *const *perms) {
+        if ((k == 0) || (inst_sz == 0)) {
+                return 0;
+        }
+        float sig[CASE_SIG_BUCKETS];
+        signature(prob_inst, inst_sz, bin_cap, sig);
+        double *best_dist = malloc(k * sizeof(*best_dist));
+        const struct case_entry **best = malloc(k * sizeof(*best));
+        struct rel_item *items = malloc(inst_sz * sizeof(*items));
+        size_t *right = malloc((inst_sz + 1) * sizeof(*right));
+        size_t *left = malloc((inst_sz + 1) * sizeof(*left));
+        if ((best_dist == NULL) || (best == NULL) || (items == NULL)
+            || (right == NULL) || (left == NULL)) {
+                abort();
+        }
+
+        store_lock(store, false);
+        /* the k nearest in the index, kept sorted; a later case goes
+         * before earlier ones at the same distance */
+        size_t num_best = 0;
+        uint64_t block_at = store_header(store)->first_block_at;
+        while (block_at != 0) {
+                const struct case_block *block = (const struct case_block *)
+                        (store->map + block_at);
+                for (uint64_t e = 0; e < block->num; e++) {
+                        const struct case_entry *entry = &block->entries[e];
+                        const double dist = sig_distance(sig, inst_sz,
+                                                         entry->sig,
+                                                         entry->inst_sz);
+                        size_t j = (num_best < k) ? num_best++ : k;
+                        while ((j > 0) && (best_dist[j - 1] >= dist)) {
+                                if (j < k) {
+                                        best_dist[j] = best_dist[j - 1];
+                                        best[j] = best[j - 1];
+                                }
+                                j--;
+                        }
+                        if (j < k) {
+                                best_dist[j] = dist;
+                                best[j] = entry;
+                        }
+                }
+                block_at = block->next_at;
+        }
+
+        for (size_t i = 0; i < inst_sz; i++) {
+                items[i] = (struct rel_item){
+                        .rel = rel_size(prob_inst[i], bin_cap),
+                        .index = i};
+        }
+        qsort(items, inst_sz, sizeof(*items), rel_item_cmp);
+        for (size_t c = 0; c < num_best; c++) {
+                lay_case((const uint16_t *)(store->map + best[c]->sizes_at),
+                         best[c]->inst_sz, items, inst_sz, right, left,
+                         perms[c]);
+        }
+        store_unlock(store);
+
+        free(best_dist);
+        free(best);
+        free(items);
+        free(right);
+        free(left);
+        return num_best;
+}
+
+static struct case_header *store_header(struct case_store *store) {
+        return (struct case_header *)store->map;
+}
+static void store_init_header(struct case_store *store) {
+        struct case_header *header = store_header(store);
+        memcpy(header->magic, CASE_MAGIC, sizeof(CASE_MAGIC));
+        header->version = CASE_VERSION;
+        header->byte_order = BYTE_ORDER_MARK;
+        header->size = sizeof(*header);
+        header->first_block_at = 0;
+        header->last_block_at = 0;
+        header->num_cases = 0;
+}
+static void store_lock(struct case_store *store,
+                       bool is_exclusive) {
+        pthread_mutex_lock(&store->lock);
+        if (store->fd >= 0) {
+                flock(store->fd, (is_exclusive) ? LOCK_EX : LOCK_SH);
+                store_sync(store);
+        }
+}
+static void store_unlock(struct case_store *store) {
+        if (store->fd >= 0) {
+                flock(store->fd, LOCK_UN);
+        }
+        pthread_mutex_unlock(&store->lock);
+}
+static void store_sync(struct case_store *store) {
+        struct stat st;
+        if ((fstat(store->fd, &st) != 0)
+            || ((size_t)st.st_size == store->map_sz)) {
+                return;
+        }
+        if (store->map != NULL) {
+                munmap(store->map, store->map_sz);
+        }
+        store->map_sz = st.st_size;
+        store->map = mmap(NULL, store->map_sz, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, store->fd, 0);
+        if (store->map == MAP_FAILED) {
+                abort();
+        }
+}
+static uint64_t store_reserve(struct case_store *store,
+                              size_t sz) {
+        const uint64_t at = (store_header(store)->size + 7)
+                            & ~(uint64_t)7;
+        if (at + sz > store->map_sz) {
+                store_grow(store, at + sz);
+        }
+        store_header(store)->size = at + sz;
+        return at;
+}
+static void store_grow(struct case_store *store,
+                       size_t min_sz) {
+        size_t new_sz = 2 * store->map_sz;
+        if (new_sz < min_sz) {
+                new_sz = min_sz;
+        }
+        if (store->fd < 0) {
+                store->map = realloc(store->map, new_sz);
+                if (store->map == NULL) {
+                        abort();
+                }
+                store->map_sz = new_sz;
+                return;
+        }
+        if (ftruncate(store->fd, new_sz) != 0) {
+                abort();
+        }
+        store_sync(store);
+}
+static uint16_t rel_size(double size,
+                         double bin_cap) {
+        const double rel = size / bin_cap;
+        if (!(rel > 0)) {
+                return 0;
+        }
+        return (rel >= 1) ? REL_MAX : (uint16_t)lround(rel * REL_MAX);
+}
+static void signature(const double *prob_inst,
+                      size_t inst_sz,
+                      double bin_cap,
+                      float *sig) {
+        size_t counts[CASE_SIG_BUCKETS] = {0};
+        for (size_t i = 0; i < inst_sz; i++) {
+                const size_t bucket = (size_t)rel_size(prob_inst[i], bin_cap)
+                                      * CASE_SIG_BUCKETS / (REL_MAX + 1);
+                counts[bucket]++;
+        }
+        for (int b = 0; b < CASE_SIG_BUCKETS; b++) {
+                sig[b] = (inst_sz > 0) ? (float)counts[b] / inst_sz : 0;
+        }
+}
+/* how far apart the size distributions are, plus how far apart the
+ * instance sizes are in orders of magnitude */
+static double sig_distance(const float *sig1,
+                           size_t sz1,
+                           const float *sig2,
+                           size_t sz2) {
+        double dist = 0.0;
+        for (int b = 0; b < CASE_SIG_BUCKETS; b++) {
+                dist += fabs((double)sig1[b] - sig2[b]);
+        }
+        if ((sz1 > 0) && (sz2 > 0)) {
+                dist += fabs(log10((double)sz1 / sz2));
+        }
+        return dist;
+}
+static int rel_item_cmp(const void *a,
+                        const void *b) {
+        const struct rel_item *ia = a;
+        const struct rel_item *ib = b;
+        if (ia->rel != ib->rel) {
+                return (ia->rel > ib->rel) - (ia->rel < ib->rel);
+        }
+        return (ia->index > ib->index) - (ia->index < ib->index);
+}
+static size_t find_right(size_t *right,
+                         size_t pos) {
+        while (right[pos] != pos) {
+                right[pos] = right[right[pos]];
+                pos = right[pos];
+        }
+        return pos;
+}
+static size_t find_left(size_t *left,
+                        size_t pos) {
+        while (left[pos] != pos) {
+                left[pos] = left[left[pos]];
+                pos = left[pos];
+        }
+        return pos;
+}
+static void lay_case(const uint16_t *case_sizes,
+                     size_t case_sz,
+                     const struct rel_item *items,
+                     size_t inst_sz,
+                     size_t *right,
+                     size_t *left,
+                     size_t *perm) {
+        /* left is shifted by one so that 0 can stand for none */
+        for (size_t i = 0; i <= inst_sz; i++) {
+                right[i] = i;
+                left[i] = i;
+        }
+        size_t num = 0;
+        for (size_t c = 0; (c < case_sz) && (num < inst_sz); c++) {
+                const uint16_t rel = case_sizes[c];
+                size_t lo = 0;
+                size_t hi = inst_sz;
+                while (lo < hi) {
+                        const size_t mid = lo + (hi - lo) / 2;
+                        if (items[mid].rel < rel) {
+                                lo = mid + 1;
+                        } else {
+                                hi = mid;
+                        }
+                }
+                const size_t up = find_right(right, lo);
+                const size_t down = find_left(left, lo);
+                size_t pick;
+                if (down == 0) {
+                        pick = up;
+                } else if (up == inst_sz) {
+                        pick = down - 1;
+                } else {
+                        pick = (items[up].rel - rel
+                                <= rel - items[down - 1].rel)
+                               ? up : down - 1;
+                }
+                perm[num++] = items[pick].index;
+                right[pick] = pick + 1;
+                left[pick + 1] = pick;
+        }
+        /* what the case had no sizes for, largest first */
+        for (size_t i = inst_sz; i-- > 0;) {
+                if (right[i] == i) {
+                        perm[num++] = items[i].index;
+                }
+        }
+}
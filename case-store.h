@@ -0,0 +1,82 @@
+#ifndef CASE_STORE_H
+#define CASE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* Good permutations of past problems, kept so later problems can start
+ * from them. A case is stored by the sizes of its items, relative to the
+ * bin capacity, in the order of the permutation, so it says nothing about
+ * which instance it came from and can be laid onto any other: each stored
+ * size in turn takes the unused item nearest in size, and items left over
+ * follow largest first. Identical instances get the very same packing.
+ *
+ * Each case is indexed by its number of items and a signature, the
+ * share of its items in each of CASE_SIG_BUCKETS equal ranges of relative
+ * size. The index lives in blocks chained through the store, apart from
+ * the sizes, so a lookup reads only the index and the cases it returns.
+ * A store is either kept in memory for the life of the process or mapped
+ * from a file, where it persists and may be shared by several processes
+ * at once. */
+#define CASE_SIG_BUCKETS        16
+#define CASE_BLOCK_ENTRIES      64
+#define CASE_MAGIC              "BPCASES"
+#define CASE_VERSION            1
+
+struct case_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        /* bytes in use; the rest of the file is room to grow */
+        uint64_t size;
+        uint64_t first_block_at;
+        uint64_t last_block_at;
+        uint64_t num_cases;
+};
+struct case_entry {
+        uint64_t inst_sz;
+        /* inst_sz uint16_t sizes, 65535 being the bin capacity */
+        uint64_t sizes_at;
+        uint64_t num_bins;
+        float sig[CASE_SIG_BUCKETS];
+};
+struct case_block {
+        /* 0 for the last block */
+        uint64_t next_at;
+        uint64_t num;
+        struct case_entry entries[CASE_BLOCK_ENTRIES];
+};
+
+struct case_store {
+        /* -1 for a store in memory */
+        int fd;
+        unsigned char *map;
+        size_t map_sz;
+        /* threads of this process; flock serializes processes */
+        pthread_mutex_t lock;
+};
+/* path NULL keeps the store in memory. Returns 0, or -1 if the file
+ * cannot be opened or is not a case store */
+int case_store_open(struct case_store *store,
+                    const char *path);
+void case_store_close(struct case_store *store);
+/* adds perm, a permutation of the items of prob_inst that packs into
+ * num_bins bins, as a case */
+void case_store_add(struct case_store *store,
+                    const double *prob_inst,
+                    size_t inst_sz,
+                    double bin_cap,
+                    const size_t *perm,
+                    int num_bins);
+/* Lays the k cases most like prob_inst onto it, most alike first and
+ * newer first among equals, writing each into the next of perms, arrays
+ * of inst_sz. Returns the number of cases written. */
+size_t case_store_find(struct case_store *store,
+                       const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap,
+                       size_t k,
+                       size_t *const *perms);
+
+#endif /* !CASE_STORE_H */
@@ -1,13 +1,28 @@
 #include "chromosome.h"
+#include "int-inst.h"
+#include "rng.h"
+#include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define SEARCHES        100
+#define DOM_ITEMS       200
+#define DOM_SEARCHES    300
 
 static void chrom_print(const struct chromosome *chrom,
                         size_t perm_sz,
                         bool is_baldwinian);
+/* asserts that sol packs every item exactly once, in bins none empty or
+ * overfull, with the loads it records */
+static void check_packing(struct solution sol,
+                          const double *prob_inst,
+                          size_t inst_sz,
+                          double bin_cap);
+/* runs chrom_search_dom over and over on a random instance, checking
+ * every packing and that the bins never grow in number */
+static void check_dom(bool use_int_sizes);
 
 int main(int argc, char **argv) {
         const double bin_cap = 20;
@@ -24,8 +39,8 @@ int main(int argc, char **argv) {
         chrom2.chrom.perm = malloc(perm_sz * sizeof(*chrom2.chrom.perm));
         memcpy(chrom1.perm, perm1, perm_sz * sizeof(*chrom1.perm));
         memcpy(chrom2.chrom.perm, perm2, perm_sz * sizeof(*chrom1.perm));
-        chrom_eval(&chrom1, prob_inst, perm_sz, bin_cap);
-        chrom_eval(&chrom2.chrom, prob_inst, perm_sz, bin_cap);
+        chrom_eval(&chrom1, NULL, prob_inst, perm_sz, bin_cap);
+        chrom_eval(&chrom2.chrom, NULL, prob_inst, perm_sz, bin_cap);
         solution_copy(&chrom2.bald_sol, chrom2.chrom.sol);
 
         printf("chrom1:\n");
@@ -38,24 +53,28 @@ int main(int argc, char **argv) {
                 printf("mutating chrom1\n");
                 chrom_mut(&chrom1, perm_sz);
                 printf("evaluating chrom1\n");
-                chrom_eval(&chrom1, prob_inst, perm_sz, bin_cap);
+                chrom_eval(&chrom1, NULL, prob_inst, perm_sz, bin_cap);
                 printf("chrom1:\n");
                 chrom_print(&chrom1, perm_sz, false);
         }
         putchar('\n');
 
         printf("crossover\n");
-        struct chromosome child = chrom_cx(chrom1, chrom2.chrom, perm_sz);
+        struct chromosome child;
+        chrom_init(&child, false);
+        child.perm = malloc(perm_sz * sizeof(*child.perm));
+        chrom_cx(&child, chrom1, chrom2.chrom, perm_sz);
         printf("evaluating child\n");
-        chrom_eval(&child, prob_inst, perm_sz, bin_cap);
+        chrom_eval(&child, NULL, prob_inst, perm_sz, bin_cap);
         printf("child:\n");
         chrom_print(&child, perm_sz, false);
         putchar('\n');
 
         printf("greedy lamarckian swap local search of child\n");
         printf("number of searches conducted: %d\n",
-               chrom_search(&child, false, prob_inst, perm_sz, bin_cap,
-                            true, SEARCHES, chrom_search_swap));
+               chrom_search(&child, false, NULL, prob_inst,
+                            perm_sz, bin_cap, true, SEARCHES,
+                            chrom_search_swap));
         printf("child:\n");
         chrom_print(&child, perm_sz, false);
         putchar('\n');
@@ -64,8 +83,9 @@ int main(int argc, char **argv) {
         chrom_print(&chrom2.chrom, perm_sz, true);
         printf("greedy baldwinian swap local search of chrom2\n");
         printf("number of searches conducted: %d\n",
-               chrom_search(&chrom2.chrom, true, prob_inst, perm_sz, bin_cap,
-                            true, SEARCHES, chrom_search_swap));
+               chrom_search(&chrom2.chrom, true, NULL, prob_inst,
+                            perm_sz, bin_cap, true, SEARCHES,
+                            chrom_search_swap));
         printf("chrom2:\n");
         chrom_print(&chrom2.chrom, perm_sz, true);
         putchar('\n');
@@ -74,8 +94,9 @@ int main(int argc, char **argv) {
         chrom_print(&chrom1, perm_sz, false);
         printf("steep lamarckian swap local search of chrom1\n");
         printf("number of searches conducted: %d\n",
-               chrom_search(&chrom1, false, prob_inst, perm_sz, bin_cap,
-                            false, SEARCHES, chrom_search_swap));
+               chrom_search(&chrom1, false, NULL, prob_inst,
+                            perm_sz, bin_cap, false, SEARCHES,
+                            chrom_search_swap));
         printf("chrom1:\n");
         chrom_print(&chrom1, perm_sz, false);
         putchar('\n');
@@ -84,15 +105,51 @@ int main(int argc, char **argv) {
         chrom_print(&chrom2.chrom, perm_sz, true);
         printf("greedy baldwinian shuffle local search of chrom2\n");
         printf("number of searches conducted: %d\n",
-               chrom_search(&chrom2.chrom, true, prob_inst, perm_sz, bin_cap,
-                            true, SEARCHES, chrom_search_shuffle));
+               chrom_search(&chrom2.chrom, true, NULL, prob_inst,
+                            perm_sz, bin_cap, true, SEARCHES,
+                            chrom_search_shuffle));
         printf("chrom2:\n");
         chrom_print(&chrom2.chrom, perm_sz, true);
         putchar('\n');
 
+        memcpy(chrom1.perm, perm2, perm_sz * sizeof(*chrom1.perm));
+        chrom1.fitness = -1;
+        chrom_eval(&chrom1, NULL, prob_inst, perm_sz, bin_cap);
+        printf("chrom1:\n");
+        chrom_print(&chrom1, perm_sz, false);
+        printf("greedy lamarckian dominance local search of chrom1\n");
+        printf("number of searches conducted: %d\n",
+               chrom_search(&chrom1, false, NULL, prob_inst,
+                            perm_sz, bin_cap, true, SEARCHES,
+                            chrom_search_dom));
+        printf("chrom1:\n");
+        chrom_print(&chrom1, perm_sz, false);
+        check_packing(chrom1.sol, prob_inst, perm_sz, bin_cap);
+        putchar('\n');
+        check_dom(false);
+        check_dom(true);
+        putchar('\n');
+
+        printf("grouping crossover of child and chrom1\n");
+        struct chromosome group_child;
+        chrom_init(&group_child, false);
+        group_child.perm = malloc(perm_sz * sizeof(*group_child.perm));
+        chrom_group_cx(&group_child, child, chrom1, prob_inst, perm_sz,
+                       bin_cap);
+        printf("group child:\n");
+        chrom_print(&group_child, perm_sz, false);
+        check_packing(group_child.sol, prob_inst, perm_sz, bin_cap);
+        printf("grouping mutation of group child\n");
+        chrom_group_mut(&group_child, prob_inst, perm_sz, bin_cap);
+        printf("group child:\n");
+        chrom_print(&group_child, perm_sz, false);
+        check_packing(group_child.sol, prob_inst, perm_sz, bin_cap);
+        putchar('\n');
+
         chrom_destroy(&chrom1, false);
         chrom_destroy(&chrom2.chrom, true);
         chrom_destroy(&child, false);
+        chrom_destroy(&group_child, false);
         return 0;
 }
 
@@ -113,3 +170,70 @@ static void chrom_print(const struct chromosome *chrom,
                 solution_print(((struct bald_chrom *)chrom)->bald_sol, stdout);
         }
 }
+static void check_packing(struct solution sol,
+                          const double *prob_inst,
+                          size_t inst_sz,
+                          double bin_cap) {
+        assert(sol.num_items == inst_sz);
+        assert(sol.bin_start[0] == 0);
+        assert(sol.bin_start[sol.num_bins] == inst_sz);
+        bool *is_seen = calloc(inst_sz, sizeof(*is_seen));
+        if (is_seen == NULL) {
+                abort();
+        }
+        for (int j = 0; j < sol.num_bins; j++) {
+                assert(sol.bin_start[j] < sol.bin_start[j + 1]);
+                double load = 0;
+                for (size_t k = sol.bin_start[j]; k < sol.bin_start[j + 1];
+                     k++) {
+                        const size_t item = sol.items[k];
+                        assert((item < inst_sz) && !is_seen[item]);
+                        assert(sol.item_bin[item] == j);
+                        is_seen[item] = true;
+                        load += prob_inst[item];
+                }
+                assert(load <= bin_cap + 1e-9);
+                assert(fabs(load - sol.bin_load[j]) < 1e-9);
+        }
+        free(is_seen);
+}
+static void check_dom(bool use_int_sizes) {
+        /* tenths, exact in integer units once registered */
+        const double bin_cap = 15;
+        double prob_inst[DOM_ITEMS];
+        size_t perm[DOM_ITEMS];
+        rng_seed(7);
+        for (size_t i = 0; i < DOM_ITEMS; i++) {
+                prob_inst[i] = (10 + rng_bounded(91)) / 10.0;
+                perm[i] = i;
+        }
+        for (size_t i = DOM_ITEMS; i-- > 1;) {
+                const size_t j = rng_bounded(i + 1);
+                const size_t tmp = perm[i];
+                perm[i] = perm[j];
+                perm[j] = tmp;
+        }
+        if (use_int_sizes) {
+                const bool is_registered = int_inst_register(prob_inst,
+                                                             DOM_ITEMS,
+                                                             bin_cap);
+                assert(is_registered);
+        }
+        struct solution sol;
+        solution_init(&sol);
+        solution_first_fit(&sol, prob_inst, DOM_ITEMS, perm, bin_cap);
+        const int first_bins = sol.num_bins;
+        for (int i = 0; i < DOM_SEARCHES; i++) {
+                const int num_bins = sol.num_bins;
+                chrom_search_dom(NULL, &sol, prob_inst, DOM_ITEMS, bin_cap);
+                check_packing(sol, prob_inst, DOM_ITEMS, bin_cap);
+                assert(sol.num_bins <= num_bins);
+        }
+        printf("dominance in %s: %d bins down to %d in %d searches\n",
+               (use_int_sizes) ? "integers" : "doubles", first_bins,
+               sol.num_bins, DOM_SEARCHES);
+        solution_destroy(sol);
+        if (use_int_sizes) {
+                int_inst_unregister(prob_inst);
+        }
+}
@@ -1,7 +1,13 @@
 #include "chromosome.h"
+#include "rng.h"
+#include "arena.h"
+#include "int-inst.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
+#include <math.h>
 #ifndef NDEBUG
 #include <stdio.h>
 #endif
@@ -11,16 +17,164 @@
 
 static void perm_rand_swap(size_t *perm,
                            size_t perm_sz);
-static size_t *perm_ox(const size_t *parent1,
-                       const size_t *parent2,
-                       size_t perm_sz);
-static int sz_sort_asc(const void *a, const void *b);
+static void perm_ox(size_t *restrict child,
+                    const size_t *restrict parent1,
+                    const size_t *restrict parent2,
+                    size_t perm_sz);
+/* per-thread state of chrom_search and chrom_cx, kept between calls */
+struct chrom_scratch {
+        struct solution sol;
+        struct ff_checkpoints cp;
+        /* item i is in the current set, such as the OX midsection, iff
+         * stamp[i] equals stamp_gen, so the set is emptied by bumping
+         * stamp_gen */
+        uint32_t *stamp;
+        size_t stamp_cap;
+        uint32_t stamp_gen;
+        /* the index of chrom_search_dom, which only grows */
+        struct dom_entry *dom_entries;
+        size_t dom_entries_cap;
+};
+static struct chrom_scratch *chrom_scratch_local(void);
+static void chrom_scratch_key_init(void);
+static void chrom_scratch_destroy(void *scratch);
+/* empties the thread's stamped set, with room for items below sz */
+static void stamp_clear(struct chrom_scratch *scratch,
+                        size_t sz);
+static size_t perm_first_diff(const size_t *perm1,
+                              const size_t *perm2,
+                              size_t perm_sz);
+
+#define NO_ITEM SIZE_MAX
+/* bins chrom_search_dom and chrom_group_mut empty besides the least
+ * filled */
+#define MAX_EXTRA_EMPTIED       2
+/* marks in is_emptied, all false, the least loaded of num_bins bins, at
+ * least two, and up to MAX_EXTRA_EMPTIED others at random, leaving one */
+static void bins_pick_emptied(bool *is_emptied,
+                              const double *load,
+                              int num_bins);
+struct ffd_item {
+        double size;
+        size_t item;
+};
+/* Puts the num_free items of free_items back first-fit decreasing into
+ * the num_bins bins sol->item_bin places every other item in, then into
+ * new bins, and lays sol out with each bin's items in their order in
+ * order, with their loads. Returns false, leaving sol as it was, if that
+ * takes more than max_bins bins. */
+static bool repack_ffd(struct solution *sol,
+                       int num_bins,
+                       int max_bins,
+                       const size_t *free_items,
+                       size_t num_free,
+                       const size_t *order,
+                       const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap);
+static int ffd_item_cmp(const void *a,
+                        const void *b);
+/* entries dom_find looks through for one that gains */
+#define DOM_MAX_SCAN            64
+/* the index is counting sorted when sizes are integers and the capacity
+ * is at most this many times the number of entries */
+#define DOM_COUNT_SORT_RATIO    8
+/* state of one chrom_search_dom call; sizes and capacity are in the
+ * exact units of the instance's int_inst when it has one */
+struct dom_state {
+        const double *size;
+        double cap;
+        /* sizes are integers */
+        bool is_int;
+        int num_bins;
+        double *load;
+        size_t *bin_count;
+        /* each bin's items as a list through next, NO_ITEM ended */
+        size_t *head;
+        size_t *next;
+        bool *is_emptied;
+        /* items out of any bin, by decreasing size */
+        size_t *free_items;
+        size_t num_free;
+        /* see struct dom_entry; points into the thread's scratch */
+        struct dom_entry *entries;
+        size_t num_entries;
+};
+/* A bin with none, one or two of its items taken out, by the room that
+ * leaves: free items of a total size up to room and above out_sum can
+ * go in their place and leave the bin fuller. The entries of every bin
+ * kept sorted by room find the fullest such bin for given free items in
+ * logarithmic time; the bins' residual capacities are the entries that
+ * take nothing out. */
+struct dom_entry {
+        double room;
+        double out_sum;
+        int bin;
+        size_t out1;
+        size_t out2;
+};
+/* builds the index of every bin not emptied */
+static void dom_index_build(struct dom_state *st);
+/* the entries of bin, added to or taken from the index */
+static void dom_index_add(struct dom_state *st,
+                          int bin);
+static void dom_index_remove(struct dom_state *st,
+                             int bin);
+/* writes the entries of bin to out, unsorted, returning their number */
+static size_t dom_bin_entries(const struct dom_state *st,
+                              int bin,
+                              struct dom_entry *out);
+static size_t dom_num_entries(size_t bin_count);
+static void dom_entries_reserve(size_t cap);
+static int dom_entry_cmp(const void *a,
+                         const void *b);
+/* the entry that free items of total size sum leave fullest, or NULL */
+static const struct dom_entry *dom_find(const struct dom_state *st,
+                                        double sum);
+/* swaps the num_in free items at positions in of the free list with
+ * what entry takes out of its bin */
+static void dom_apply(struct dom_state *st,
+                      struct dom_entry entry,
+                      const size_t *in,
+                      int num_in);
+static void dom_bin_remove(struct dom_state *st,
+                           int bin,
+                           size_t item);
+static void dom_bin_add(struct dom_state *st,
+                        int bin,
+                        size_t item);
+static void dom_sort_free(struct dom_state *st);
+/* relocations dom_relocate makes at most */
+#define DOM_MAX_RELOCATES       8
+/* Moves items out of the least filled bin of sol, each into the bin that
+ * move_eval_relocate shows it leaves fullest, while any fits; out of the
+ * least filled bin, every such move raises the fitness. Returns whether
+ * it moved any. */
+static bool dom_relocate(struct solution *sol,
+                         const double *prob_inst,
+                         size_t inst_sz,
+                         double bin_cap);
+
+/* repack_ffd of chrom's solution, which chrom then takes on as its
+ * packing */
+static void group_repack(struct chromosome *chrom,
+                         int num_bins,
+                         const size_t *free_items,
+                         size_t num_free,
+                         const size_t *order,
+                         const double *prob_inst,
+                         size_t inst_sz,
+                         double bin_cap);
+
+static pthread_key_t chrom_scratch_key;
+static pthread_once_t chrom_scratch_once = PTHREAD_ONCE_INIT;
 
 void chrom_init(struct chromosome *chrom,
                 bool is_baldwinian) {
         chrom->fitness = -1;
         chrom->perm = NULL;
         solution_init(&chrom->sol);
+        ff_checkpoints_init(&chrom->cp);
         if (is_baldwinian) {
                 solution_init(&CHROM2BALD(chrom)->bald_sol);
         }
@@ -32,57 +186,205 @@ void chrom_destroy(struct chromosome *chrom,
         }
         free(chrom->perm);
         solution_destroy(chrom->sol);
+        ff_checkpoints_destroy(chrom->cp);
         if (is_baldwinian) {
                 solution_destroy(CHROM2BALD(chrom)->bald_sol);
         }
 }
 void chrom_eval(struct chromosome *chrom,
+                struct fitness_cache *cache,
                 const double *prob_inst,
                 size_t inst_sz,
                 double bin_cap) {
         if (chrom->fitness >= 0) {
                 return;
         }
-        solution_destroy(chrom->sol);
-        solution_first_fit(&chrom->sol, prob_inst, inst_sz,
-                           chrom->perm, bin_cap);
+        chrom->hash = perm_hash(chrom->perm, inst_sz);
+        int num_bins;
+        if (fitness_cache_find(cache, chrom->hash, &chrom->fitness,
+                               &num_bins)) {
+                solution_clear(&chrom->sol);
+                ff_checkpoints_invalidate(&chrom->cp);
+                return;
+        }
+        solution_first_fit_record(&chrom->sol, &chrom->cp, prob_inst,
+                                  inst_sz, chrom->perm, bin_cap);
         chrom->fitness = solution_eval(chrom->sol, bin_cap);
+        fitness_cache_store(cache, chrom->hash, chrom->fitness,
+                            chrom->sol.num_bins);
+}
+void chrom_decode(struct chromosome *chrom,
+                  const double *prob_inst,
+                  size_t inst_sz,
+                  double bin_cap) {
+        if (chrom->sol.num_items == inst_sz) {
+                return;
+        }
+        solution_first_fit_record(&chrom->sol, &chrom->cp, prob_inst,
+                                  inst_sz, chrom->perm, bin_cap);
 }
 
 void chrom_mut(struct chromosome *chrom,
                size_t inst_sz) {
         if (chrom->fitness > 0) {
                 chrom->fitness = -1;
-                solution_destroy(chrom->sol);
-                solution_init(&chrom->sol);
+                solution_clear(&chrom->sol);
         }
+        ff_checkpoints_invalidate(&chrom->cp);
         perm_rand_swap(chrom->perm, inst_sz);
 }
 /* OX - Order Crossover */
-struct chromosome chrom_cx(struct chromosome parent1,
-                           struct chromosome parent2,
-                           size_t inst_sz) {
-        struct chromosome child;
-        chrom_init(&child, false);
-        child.perm = perm_ox(parent1.perm, parent2.perm, inst_sz);
-        return child;
+void chrom_cx(struct chromosome *child,
+              struct chromosome parent1,
+              struct chromosome parent2,
+              size_t inst_sz) {
+        child->fitness = -1;
+        solution_clear(&child->sol);
+        ff_checkpoints_invalidate(&child->cp);
+        perm_ox(child->perm, parent1.perm, parent2.perm, inst_sz);
+}
+void chrom_group_cx(struct chromosome *child,
+                    struct chromosome parent1,
+                    struct chromosome parent2,
+                    const double *prob_inst,
+                    size_t inst_sz,
+                    double bin_cap) {
+        const struct solution p1 = parent1.sol;
+        const struct solution p2 = parent2.sol;
+        assert((p1.num_items == inst_sz) && (p2.num_items == inst_sz));
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        struct chrom_scratch *scratch = chrom_scratch_local();
+        stamp_clear(scratch, inst_sz);
+        uint32_t *stamp = scratch->stamp;
+        const uint32_t gen = scratch->stamp_gen;
+
+        /* parent2's bins from i1 up to i2 go in before parent1's bin at */
+        int i1, i2;
+        i1 = rng_bounded(p2.num_bins + 1);
+        while (i2 = rng_bounded(p2.num_bins + 1), i2 == i1);
+        if (i1 > i2) {
+                int tmp = i1;
+                i1 = i2;
+                i2 = tmp;
+        }
+        const int at = rng_bounded(p1.num_bins + 1);
+        const size_t in_start = p2.bin_start[i1];
+        const size_t in_end = p2.bin_start[i2];
+        for (size_t k = in_start; k < in_end; k++) {
+                stamp[p2.items[k]] = gen;
+        }
+
+        /* parent1's bins holding none of the items injected are kept, in
+         * their order, around the injected ones */
+        bool *is_dropped = arena_alloc(arena,
+                                       p1.num_bins * sizeof(*is_dropped));
+        memset(is_dropped, 0, p1.num_bins * sizeof(*is_dropped));
+        for (size_t k = in_start; k < in_end; k++) {
+                is_dropped[p1.item_bin[p2.items[k]]] = true;
+        }
+        int *renum = arena_alloc(arena, p1.num_bins * sizeof(*renum));
+        const int num_in = i2 - i1;
+        int num_bins = 0;
+        for (int j = 0; j < p1.num_bins; j++) {
+                if (j == at) {
+                        num_bins += num_in;
+                }
+                renum[j] = (is_dropped[j]) ? -1 : num_bins++;
+        }
+        /* the injected bins follow the kept bins before at */
+        int first_in = 0;
+        for (int j = 0; j < at; j++) {
+                first_in += !is_dropped[j];
+        }
+        if (at == p1.num_bins) {
+                num_bins += num_in;
+        }
+
+        solution_assign(&child->sol, p1);
+        struct solution *sol = &child->sol;
+        size_t *order = arena_alloc(arena, inst_sz * sizeof(*order));
+        size_t *free_items = arena_alloc(arena,
+                                         inst_sz * sizeof(*free_items));
+        size_t num_free = 0;
+        size_t num_order = 0;
+        for (size_t k = in_start; k < in_end; k++) {
+                const size_t item = p2.items[k];
+                sol->item_bin[item] = first_in + (p2.item_bin[item] - i1);
+                order[num_order++] = item;
+        }
+        for (size_t k = 0; k < inst_sz; k++) {
+                const size_t item = p1.items[k];
+                if (stamp[item] == gen) {
+                        continue;
+                }
+                order[num_order++] = item;
+                sol->item_bin[item] = renum[p1.item_bin[item]];
+                if (sol->item_bin[item] < 0) {
+                        free_items[num_free++] = item;
+                }
+        }
+        group_repack(child, num_bins, free_items, num_free, order,
+                     prob_inst, inst_sz, bin_cap);
+        arena_release(arena, mark);
+}
+void chrom_group_mut(struct chromosome *chrom,
+                     const double *prob_inst,
+                     size_t inst_sz,
+                     double bin_cap) {
+        chrom_decode(chrom, prob_inst, inst_sz, bin_cap);
+        struct solution *sol = &chrom->sol;
+        const int num_bins = sol->num_bins;
+        if (num_bins < 2) {
+                return;
+        }
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        bool *is_emptied = arena_alloc(arena, num_bins * sizeof(*is_emptied));
+        memset(is_emptied, 0, num_bins * sizeof(*is_emptied));
+        bins_pick_emptied(is_emptied, sol->bin_load, num_bins);
+        int *renum = arena_alloc(arena, num_bins * sizeof(*renum));
+        int num_kept = 0;
+        for (int j = 0; j < num_bins; j++) {
+                renum[j] = (is_emptied[j]) ? -1 : num_kept++;
+        }
+        size_t *order = arena_alloc(arena, inst_sz * sizeof(*order));
+        size_t *free_items = arena_alloc(arena,
+                                         inst_sz * sizeof(*free_items));
+        size_t num_free = 0;
+        memcpy(order, sol->items, inst_sz * sizeof(*order));
+        for (size_t k = 0; k < inst_sz; k++) {
+                const size_t item = order[k];
+                sol->item_bin[item] = renum[sol->item_bin[item]];
+                if (sol->item_bin[item] < 0) {
+                        free_items[num_free++] = item;
+                }
+        }
+        group_repack(chrom, num_kept, free_items, num_free, order,
+                     prob_inst, inst_sz, bin_cap);
+        arena_release(arena, mark);
 }
 
 int chrom_search(struct chromosome *chrom,
                  bool is_baldwinian,
+                 struct fitness_cache *cache,
                  const double *prob_inst,
                  size_t inst_sz,
                  double bin_cap,
                  bool is_greedy,
                  int max_searches,
                  chrom_search_func get_neighbor) {
+        chrom_decode(chrom, prob_inst, inst_sz, bin_cap);
         /* permutation to be passed to get_neighbor */
-        size_t *working_perm = malloc(inst_sz * sizeof(*working_perm));
-        if (working_perm == NULL) {
-                abort();
-        }
-        /* solution struct to be passed to get_neighbor */
-        struct solution working_sol;
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        size_t *working_perm = arena_alloc(arena,
+                                           inst_sz * sizeof(*working_perm));
+        /* solution to be passed to get_neighbor; its storage is kept per
+         * thread and swapped with the chromosome's on acceptance, so no
+         * neighbor allocates once the storage has grown large enough */
+        struct chrom_scratch *scratch = chrom_scratch_local();
+        struct solution *working_sol = &scratch->sol;
         /* location to store current best solution */
         struct solution *best_sol_ptr;
         if (is_baldwinian) {
@@ -96,45 +398,81 @@ int chrom_search(struct chromosome *chrom,
                 /* revert changes that made a worse neighbor */
                 memcpy(working_perm, chrom->perm,
                        inst_sz * sizeof(*working_perm));
-                solution_copy(&working_sol, chrom->sol);
+                solution_assign(working_sol, chrom->sol);
 
                 /* flag returns used to determine if permutation needs to
                  * be recreated via reverse-first-fit or if solution needs
                  * to be created from permutation */
                 struct search_flags flags;
-                flags = get_neighbor(working_perm, &working_sol, prob_inst,
+                flags = get_neighbor(working_perm, working_sol, prob_inst,
                                      inst_sz, bin_cap);
-                if (!flags.sol_modified) {
-                        solution_first_fit(&working_sol, prob_inst, inst_sz,
-                                           working_perm, bin_cap);
-                } else if (!flags.perm_modified) {
-                        free(working_perm);
-                        working_perm
-                                = solution_reverse_first_fit(working_sol,
+                if (flags.sol_modified && !flags.perm_modified) {
+                        solution_reverse_first_fit_into(*working_sol,
+                                                        working_perm);
+                }
+                const size_t first_changed = perm_first_diff(working_perm,
+                                                             chrom->perm,
                                                              inst_sz);
-                        solution_first_fit(&working_sol, prob_inst, inst_sz,
-                                           working_perm, bin_cap);
+                const uint64_t working_hash = perm_hash_update(chrom->hash,
+                                                               chrom->perm,
+                                                               working_perm,
+                                                               first_changed,
+                                                               inst_sz);
+                double working_fitness;
+                int num_bins;
+                const bool is_cached = fitness_cache_find(cache, working_hash,
+                                                          &working_fitness,
+                                                          &num_bins);
+                if (is_cached && !(working_fitness > chrom->fitness)) {
+                        continue;
+                }
+                /* decoding resumes from the last checkpoint of chrom->perm
+                 * before the first position the neighbor changed */
+                bool has_cp = false;
+                if (!flags.sol_modified || !flags.perm_modified) {
+                        solution_first_fit_resume(working_sol, &scratch->cp,
+                                                  chrom->sol, &chrom->cp,
+                                                  prob_inst, inst_sz,
+                                                  working_perm, first_changed,
+                                                  bin_cap);
+                        has_cp = true;
                 }
 
-                double working_fitness = solution_eval(working_sol, bin_cap);
+                working_fitness = solution_eval(*working_sol, bin_cap);
+                if (!is_cached) {
+                        fitness_cache_store(cache, working_hash,
+                                            working_fitness,
+                                            working_sol->num_bins);
+                }
                 if (working_fitness > chrom->fitness) {
                         /* accept new best permutation/solution */
                         chrom->fitness = working_fitness;
-                        solution_destroy(*best_sol_ptr);
-                        *best_sol_ptr = working_sol;
+                        struct solution tmp = *best_sol_ptr;
+                        *best_sol_ptr = *working_sol;
+                        *working_sol = tmp;
                         if (!is_baldwinian) {
                                 memcpy(chrom->perm, working_perm,
                                        inst_sz * sizeof(*chrom->perm));
+                                chrom->hash = working_hash;
+                                if (has_cp) {
+                                        ff_checkpoints_copy_prefix(
+                                                &scratch->cp, &chrom->cp,
+                                                first_changed);
+                                        struct ff_checkpoints tmp_cp
+                                                = chrom->cp;
+                                        chrom->cp = scratch->cp;
+                                        scratch->cp = tmp_cp;
+                                } else {
+                                        ff_checkpoints_invalidate(&chrom->cp);
+                                }
                         }
                         if (is_greedy) {
                                 break;
                         }
-                } else {
-                        solution_destroy(working_sol);
                 }
         }
 
-        free(working_perm);
+        arena_release(arena, mark);
         return num_searches;
 }
 
@@ -155,11 +493,9 @@ struct search_flags chrom_search_shuffle(size_t *unused,
                                          double bin_cap) {
         (void)unused;
         int i1, i2;
-        i1 = rand() % sol->num_bins;
-        while (i2 = rand() % sol->num_bins, i2 == i1);
-        struct bin tmp = sol->bins[i1];
-        sol->bins[i1] = sol->bins[i2];
-        sol->bins[i2] = tmp;
+        i1 = rng_bounded(sol->num_bins);
+        while (i2 = rng_bounded(sol->num_bins), i2 == i1);
+        solution_swap_bins(sol, i1, i2);
         return (struct search_flags){.perm_modified = false,
                                      .sol_modified = true};
 }
@@ -168,30 +504,174 @@ struct search_flags chrom_search_dom(size_t *unused,
                                      const double *prob_inst,
                                      size_t inst_sz,
                                      double bin_cap) {
-        abort();
+        (void)unused;
+        if (sol->num_bins < 2) {
+                return (struct search_flags){.perm_modified = false,
+                                             .sol_modified = false};
+        }
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        const int num_bins = sol->num_bins;
+        const struct int_inst *ii = int_inst_find(prob_inst, inst_sz,
+                                                  bin_cap);
+        struct dom_state st = {.cap = bin_cap, .num_bins = num_bins};
+        double *size = arena_alloc(arena, inst_sz * sizeof(*size));
+        for (size_t i = 0; i < inst_sz; i++) {
+                size[i] = (ii != NULL) ? ii->sizes[i] : prob_inst[i];
+        }
+        if (ii != NULL) {
+                st.cap = ii->cap;
+                st.is_int = true;
+        }
+        st.size = size;
+        st.load = arena_alloc(arena, num_bins * sizeof(*st.load));
+        st.bin_count = arena_alloc(arena, num_bins * sizeof(*st.bin_count));
+        st.head = arena_alloc(arena, num_bins * sizeof(*st.head));
+        st.next = arena_alloc(arena, inst_sz * sizeof(*st.next));
+        st.is_emptied = arena_alloc(arena,
+                                    num_bins * sizeof(*st.is_emptied));
+        st.free_items = arena_alloc(arena, inst_sz * sizeof(*st.free_items));
+        st.num_free = 0;
+        for (int j = 0; j < num_bins; j++) {
+                st.load[j] = 0.0;
+                st.bin_count[j] = 0;
+                st.head[j] = NO_ITEM;
+                st.is_emptied[j] = false;
+                for (size_t k = sol->bin_start[j + 1];
+                     k-- > sol->bin_start[j];) {
+                        dom_bin_add(&st, j, sol->items[k]);
+                }
+        }
+
+        /* empty the least filled bin and a few others at random */
+        bins_pick_emptied(st.is_emptied, st.load, num_bins);
+        for (int j = 0; j < num_bins; j++) {
+                if (!st.is_emptied[j]) {
+                        continue;
+                }
+                for (size_t i = st.head[j]; i != NO_ITEM; i = st.next[i]) {
+                        st.free_items[st.num_free++] = i;
+                }
+                st.head[j] = NO_ITEM;
+                st.bin_count[j] = 0;
+                st.load[j] = 0.0;
+        }
+        dom_sort_free(&st);
+
+        struct chrom_scratch *scratch = chrom_scratch_local();
+        dom_index_build(&st);
+        /* the best exchange of one to three free items at a time, until
+         * none leaves a bin fuller */
+        while (st.num_free > 0) {
+                st.entries = scratch->dom_entries;
+                const double max_room = (st.num_entries > 0)
+                        ? st.entries[st.num_entries - 1].room : 0.0;
+                const struct dom_entry *best = NULL;
+                size_t best_in[3];
+                int best_num_in = 0;
+                double best_sum = 0.0;
+                const size_t m = st.num_free;
+                const size_t *fr = st.free_items;
+#define DOM_TRY(SUM, NUM_IN, ...) \
+        do { \
+                const struct dom_entry *entry = dom_find(&st, SUM); \
+                if ((entry != NULL) \
+                    && ((best == NULL) \
+                        || (entry->room - (SUM) \
+                            < best->room - best_sum))) { \
+                        best = entry; \
+                        best_sum = SUM; \
+                        best_num_in = NUM_IN; \
+                        memcpy(best_in, (size_t[]){__VA_ARGS__}, \
+                               NUM_IN * sizeof(*best_in)); \
+                } \
+        } while (0)
+                for (size_t a = 0; a < m; a++) {
+                        const double sum1 = size[fr[a]];
+                        if (sum1 > max_room) {
+                                continue;
+                        }
+                        DOM_TRY(sum1, 1, a);
+                        for (size_t b = a + 1; b < m; b++) {
+                                const double sum2 = sum1 + size[fr[b]];
+                                if (sum2 > max_room) {
+                                        continue;
+                                }
+                                DOM_TRY(sum2, 2, a, b);
+                                for (size_t c = b + 1; c < m; c++) {
+                                        const double sum3 = sum2
+                                                            + size[fr[c]];
+                                        if (sum3 <= max_room) {
+                                                DOM_TRY(sum3, 3, a, b, c);
+                                        }
+                                }
+                        }
+                }
+#undef DOM_TRY
+                if (best == NULL) {
+                        break;
+                }
+                dom_apply(&st, *best, best_in, best_num_in);
+        }
+
+        /* the bins kept, in their order; what is still free fits none
+         * of them, so goes first-fit decreasing into new bins, unless
+         * that takes more bins than there were */
+        int *old_bin = arena_alloc(arena, inst_sz * sizeof(*old_bin));
+        memcpy(old_bin, sol->item_bin, inst_sz * sizeof(*old_bin));
+        int num_kept = 0;
+        for (int j = 0; j < num_bins; j++) {
+                const int bin = (st.bin_count[j] > 0) ? num_kept++ : -1;
+                for (size_t i = st.head[j]; i != NO_ITEM; i = st.next[i]) {
+                        sol->item_bin[i] = bin;
+                }
+        }
+        for (size_t f = 0; f < st.num_free; f++) {
+                sol->item_bin[st.free_items[f]] = -1;
+        }
+        size_t *order = arena_alloc(arena, inst_sz * sizeof(*order));
+        memcpy(order, sol->items, inst_sz * sizeof(*order));
+        const bool is_repacked = repack_ffd(sol, num_kept, num_bins,
+                                            st.free_items, st.num_free,
+                                            order, prob_inst, inst_sz,
+                                            bin_cap);
+        if (!is_repacked) {
+                memcpy(sol->item_bin, old_bin,
+                       inst_sz * sizeof(*old_bin));
+        }
+        /* the exchanges only weighed free items; the kept bins' own can
+         * still move out of whichever bin is now least filled */
+        const bool is_relocated = dom_relocate(sol, prob_inst, inst_sz,
+                                               bin_cap);
+
+        arena_release(arena, mark);
+        return (struct search_flags){.perm_modified = false,
+                                     .sol_modified = is_repacked
+                                                     || is_relocated};
 }
 
 static void perm_rand_swap(size_t *perm,
                            size_t perm_sz) {
         size_t i1, i2;
-        i1 = rand() % perm_sz;
-        while (i2 = rand() % perm_sz, i2 == i1);
+        i1 = rng_bounded(perm_sz);
+        while (i2 = rng_bounded(perm_sz), i2 == i1);
         size_t tmp = perm[i1];
         perm[i1] = perm[i2];
         perm[i2] = tmp;
 }
-static size_t *perm_ox(const size_t *parent1,
-                       const size_t *parent2,
-                       size_t perm_sz) {
-        size_t *child = malloc(perm_sz * sizeof(*child));
-        if (child == NULL) {
-                abort();
-        }
+static void perm_ox(size_t *restrict child,
+                    const size_t *restrict parent1,
+                    const size_t *restrict parent2,
+                    size_t perm_sz) {
+        struct chrom_scratch *scratch = chrom_scratch_local();
+        stamp_clear(scratch, perm_sz);
+        uint32_t *restrict stamp = scratch->stamp;
+        const uint32_t gen = scratch->stamp_gen;
 
         /* cut points are just before i1/i2 */
         size_t i1, i2;
-        i1 = rand() % (perm_sz + 1);
-        while (i2 = rand() % (perm_sz + 1), i2 == i1);
+        i1 = rng_bounded(perm_sz + 1);
+        while (i2 = rng_bounded(perm_sz + 1), i2 == i1);
         if (i1 > i2) {
                 size_t tmp = i1;
                 i1 = i2;
@@ -199,30 +679,20 @@ static size_t *perm_ox(const size_t *parent1,
         }
         /* copy midsection of parent1 to child in same spot */
         memcpy(child + i1, parent1 + i1, (i2 - i1) * sizeof(*child));
-
-        /* create sorted array of used values for binary search */
-        size_t *used_vals = malloc((i2 - i1) * sizeof(*used_vals));
-        if (used_vals == NULL) {
-                abort();
+        for (size_t i = i1; i < i2; i++) {
+                stamp[parent1[i]] = gen;
         }
-        memcpy(used_vals, parent1 + i1, (i2 - i1) * sizeof(*child));
-        qsort(used_vals, (i2 - i1), sizeof(*used_vals), sz_sort_asc);
 
         /* copy all values not in child from parent2 starting at i2,
-         * wrapping as necessary */
+         * wrapping as necessary; exactly the positions outside the
+         * midsection get filled */
         size_t child_pos = i2;
-        bool has_wrapped = false;
-        for (size_t i = i2;
-             (!(has_wrapped && (i >= i2)) && (child_pos != i1));
-             i++) {
+        size_t i = i2;
+        for (size_t k = 0; k < perm_sz; k++, i++) {
                 if (i == perm_sz) {
                         i = 0;
-                        has_wrapped = true;
                 }
-                /* search used_vals for current element */
-                size_t *found_val = bsearch(parent2 + i, used_vals, (i2 - i1),
-                                            sizeof(*found_val), sz_sort_asc);
-                if (found_val == NULL) {
+                if (stamp[parent2[i]] != gen) {
                         if (child_pos == perm_sz) {
                                 child_pos = 0;
                         }
@@ -230,17 +700,469 @@ static size_t *perm_ox(const size_t *parent1,
                         child_pos++;
                 }
         }
-        free(used_vals);
-        return child;
 }
-static int sz_sort_asc(const void *a, const void *b) {
-        const size_t *av = a;
-        const size_t *bv = b;
-        if (*av > *bv) {
-                return 1;
-        } else if (*av < *bv) {
-                return -1;
-        } else {
-                return 0;
+static struct chrom_scratch *chrom_scratch_local(void) {
+        pthread_once(&chrom_scratch_once, chrom_scratch_key_init);
+        struct chrom_scratch *scratch
+                = pthread_getspecific(chrom_scratch_key);
+        if (scratch == NULL) {
+                scratch = malloc(sizeof(*scratch));
+                if (scratch == NULL) {
+                        abort();
+                }
+                solution_init(&scratch->sol);
+                ff_checkpoints_init(&scratch->cp);
+                scratch->stamp = NULL;
+                scratch->stamp_cap = 0;
+                scratch->stamp_gen = 0;
+                scratch->dom_entries = NULL;
+                scratch->dom_entries_cap = 0;
+                pthread_setspecific(chrom_scratch_key, scratch);
+        }
+        return scratch;
+}
+static void chrom_scratch_key_init(void) {
+        if (pthread_key_create(&chrom_scratch_key, chrom_scratch_destroy)
+            != 0) {
+                abort();
+        }
+}
+static void chrom_scratch_destroy(void *scratch) {
+        struct chrom_scratch *scratchv = scratch;
+        solution_destroy(scratchv->sol);
+        ff_checkpoints_destroy(scratchv->cp);
+        free(scratchv->stamp);
+        free(scratchv->dom_entries);
+        free(scratch);
+}
+static void stamp_clear(struct chrom_scratch *scratch,
+                        size_t sz) {
+        if (scratch->stamp_cap < sz) {
+                free(scratch->stamp);
+                scratch->stamp = calloc(sz, sizeof(*scratch->stamp));
+                if (scratch->stamp == NULL) {
+                        abort();
+                }
+                scratch->stamp_cap = sz;
+                scratch->stamp_gen = 0;
+        }
+        scratch->stamp_gen++;
+        if (scratch->stamp_gen == 0) {
+                /* wrapped; stale stamps could match again */
+                memset(scratch->stamp, 0,
+                       scratch->stamp_cap * sizeof(*scratch->stamp));
+                scratch->stamp_gen = 1;
+        }
+}
+static size_t perm_first_diff(const size_t *perm1,
+                              const size_t *perm2,
+                              size_t perm_sz) {
+        size_t i = 0;
+        while ((i < perm_sz) && (perm1[i] == perm2[i])) {
+                i++;
+        }
+        return i;
+}
+static void dom_index_build(struct dom_state *st) {
+        size_t num = 0;
+        for (int j = 0; j < st->num_bins; j++) {
+                num += dom_num_entries(st->bin_count[j]);
+        }
+        dom_entries_reserve(2 * num);
+        st->entries = chrom_scratch_local()->dom_entries;
+        /* gathered in the upper half, sorted into the lower */
+        struct dom_entry *gathered = st->entries + num;
+        size_t n = 0;
+        for (int j = 0; j < st->num_bins; j++) {
+                if (!st->is_emptied[j]) {
+                        n += dom_bin_entries(st, j, gathered + n);
+                }
+        }
+        st->num_entries = n;
+        if (!st->is_int || (st->cap > DOM_COUNT_SORT_RATIO * (double)n)) {
+                memcpy(st->entries, gathered, n * sizeof(*gathered));
+                qsort(st->entries, n, sizeof(*st->entries), dom_entry_cmp);
+                return;
+        }
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        const size_t num_rooms = (size_t)st->cap + 1;
+        size_t *start = arena_alloc(arena, (num_rooms + 1) * sizeof(*start));
+        memset(start, 0, (num_rooms + 1) * sizeof(*start));
+        for (size_t e = 0; e < n; e++) {
+                start[(size_t)gathered[e].room + 1]++;
+        }
+        for (size_t r = 1; r <= num_rooms; r++) {
+                start[r] += start[r - 1];
+        }
+        for (size_t e = 0; e < n; e++) {
+                st->entries[start[(size_t)gathered[e].room]++] = gathered[e];
+        }
+        arena_release(arena, mark);
+}
+static void dom_index_add(struct dom_state *st,
+                          int bin) {
+        const size_t num_new = dom_num_entries(st->bin_count[bin]);
+        dom_entries_reserve(st->num_entries + (2 * num_new));
+        struct dom_entry *entries = chrom_scratch_local()->dom_entries;
+        st->entries = entries;
+        /* built past the space the merge fills, then merged from the
+         * back */
+        struct dom_entry *added = entries + st->num_entries + num_new;
+        const size_t n = dom_bin_entries(st, bin, added);
+        qsort(added, n, sizeof(*added), dom_entry_cmp);
+        size_t a = st->num_entries;
+        size_t b = n;
+        size_t out = st->num_entries + n;
+        while (b > 0) {
+                if ((a > 0) && (entries[a - 1].room > added[b - 1].room)) {
+                        entries[--out] = entries[--a];
+                } else {
+                        entries[--out] = added[--b];
+                }
+        }
+        st->num_entries += n;
+}
+static size_t dom_bin_entries(const struct dom_state *st,
+                              int bin,
+                              struct dom_entry *out) {
+        const double residual = st->cap - st->load[bin];
+        size_t n = 0;
+        out[n++] = (struct dom_entry){.room = residual,
+                                      .out_sum = 0.0,
+                                      .bin = bin,
+                                      .out1 = NO_ITEM,
+                                      .out2 = NO_ITEM};
+        for (size_t i = st->head[bin]; i != NO_ITEM; i = st->next[i]) {
+                out[n++] = (struct dom_entry){.room = residual + st->size[i],
+                                              .out_sum = st->size[i],
+                                              .bin = bin,
+                                              .out1 = i,
+                                              .out2 = NO_ITEM};
+                for (size_t k = st->next[i]; k != NO_ITEM; k = st->next[k]) {
+                        const double out_sum = st->size[i] + st->size[k];
+                        out[n++] = (struct dom_entry){
+                                .room = residual + out_sum,
+                                .out_sum = out_sum,
+                                .bin = bin,
+                                .out1 = i,
+                                .out2 = k};
+                }
+        }
+        return n;
+}
+/* nothing out, one item out, or two */
+static size_t dom_num_entries(size_t bin_count) {
+        return 1 + bin_count + (bin_count * (bin_count - 1) / 2);
+}
+static void dom_index_remove(struct dom_state *st,
+                             int bin) {
+        size_t kept = 0;
+        for (size_t e = 0; e < st->num_entries; e++) {
+                if (st->entries[e].bin != bin) {
+                        st->entries[kept++] = st->entries[e];
+                }
+        }
+        st->num_entries = kept;
+}
+static void dom_entries_reserve(size_t cap) {
+        struct chrom_scratch *scratch = chrom_scratch_local();
+        if (scratch->dom_entries_cap >= cap) {
+                return;
+        }
+        size_t new_cap = 2 * scratch->dom_entries_cap;
+        if (new_cap < cap) {
+                new_cap = cap;
+        }
+        scratch->dom_entries = realloc(scratch->dom_entries,
+                                       new_cap
+                                       * sizeof(*scratch->dom_entries));
+        if (scratch->dom_entries == NULL) {
+                abort();
+        }
+        scratch->dom_entries_cap = new_cap;
+}
+static int dom_entry_cmp(const void *a,
+                         const void *b) {
+        const struct dom_entry *ea = a;
+        const struct dom_entry *eb = b;
+        return (ea->room > eb->room) - (ea->room < eb->room);
+}
+static const struct dom_entry *dom_find(const struct dom_state *st,
+                                        double sum) {
+        size_t lo = 0;
+        size_t hi = st->num_entries;
+        while (lo < hi) {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (st->entries[mid].room < sum) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        /* the entries that fit but would not gain are passed over, up
+         * to a point */
+        const size_t end = (st->num_entries - lo > DOM_MAX_SCAN)
+                           ? lo + DOM_MAX_SCAN : st->num_entries;
+        for (size_t e = lo; e < end; e++) {
+                if (st->entries[e].out_sum < sum) {
+                        return &st->entries[e];
+                }
+        }
+        return NULL;
+}
+static void dom_apply(struct dom_state *st,
+                      struct dom_entry entry,
+                      const size_t *in,
+                      int num_in) {
+        const int bin = entry.bin;
+        dom_index_remove(st, bin);
+        size_t in_items[3];
+        for (int k = 0; k < num_in; k++) {
+                in_items[k] = st->free_items[in[k]];
+        }
+        /* in is increasing, so later positions go first */
+        for (int k = num_in; k-- > 0;) {
+                st->free_items[in[k]] = st->free_items[--st->num_free];
+        }
+        for (int k = 0; k < num_in; k++) {
+                dom_bin_add(st, bin, in_items[k]);
+        }
+        if (entry.out1 != NO_ITEM) {
+                dom_bin_remove(st, bin, entry.out1);
+                st->free_items[st->num_free++] = entry.out1;
+        }
+        if (entry.out2 != NO_ITEM) {
+                dom_bin_remove(st, bin, entry.out2);
+                st->free_items[st->num_free++] = entry.out2;
+        }
+        dom_sort_free(st);
+        dom_index_add(st, bin);
+}
+static void dom_bin_remove(struct dom_state *st,
+                           int bin,
+                           size_t item) {
+        size_t *link = &st->head[bin];
+        while (*link != item) {
+                link = &st->next[*link];
+        }
+        *link = st->next[item];
+        st->bin_count[bin]--;
+        st->load[bin] -= st->size[item];
+}
+static void dom_bin_add(struct dom_state *st,
+                        int bin,
+                        size_t item) {
+        st->next[item] = st->head[bin];
+        st->head[bin] = item;
+        st->bin_count[bin]++;
+        st->load[bin] += st->size[item];
+}
+/* insertion sort; the free list stays short */
+static void dom_sort_free(struct dom_state *st) {
+        size_t *fr = st->free_items;
+        for (size_t i = 1; i < st->num_free; i++) {
+                const size_t item = fr[i];
+                size_t j = i;
+                while ((j > 0) && (st->size[fr[j - 1]] < st->size[item])) {
+                        fr[j] = fr[j - 1];
+                        j--;
+                }
+                fr[j] = item;
+        }
+}
+static bool dom_relocate(struct solution *sol,
+                         const double *prob_inst,
+                         size_t inst_sz,
+                         double bin_cap) {
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        size_t *order = arena_alloc(arena, inst_sz * sizeof(*order));
+        int num_moves = 0;
+        while ((num_moves < DOM_MAX_RELOCATES) && (sol->num_bins > 1)) {
+                /* the least filled bin, and the lightest bin but it,
+                 * whose room is the most any item could move into */
+                int from = 0;
+                int next = -1;
+                for (int j = 1; j < sol->num_bins; j++) {
+                        if (sol->bin_load[j] < sol->bin_load[from]) {
+                                next = from;
+                                from = j;
+                        } else if ((next < 0) || (sol->bin_load[j]
+                                                  < sol->bin_load[next])) {
+                                next = j;
+                        }
+                }
+                const double room = bin_cap - sol->bin_load[next];
+                bool may_fit = false;
+                for (size_t k = sol->bin_start[from];
+                     k < sol->bin_start[from + 1]; k++) {
+                        /* move_eval_relocate decides in exact units */
+                        may_fit |= prob_inst[sol->items[k]] <= room + 1e-9;
+                }
+                if (!may_fit) {
+                        break;
+                }
+                struct move_eval me;
+                move_eval_init(&me, sol, prob_inst, inst_sz, bin_cap);
+                size_t item = NO_ITEM;
+                int to = -1;
+                double gain = 0.0;
+                for (size_t k = sol->bin_start[from];
+                     k < sol->bin_start[from + 1]; k++) {
+                        for (int j = 0; j < sol->num_bins; j++) {
+                                const struct move_delta d =
+                                        move_eval_relocate(&me,
+                                                           sol->items[k],
+                                                           j);
+                                if (d.fits && (d.fitness > gain)) {
+                                        item = sol->items[k];
+                                        to = j;
+                                        gain = d.fitness;
+                                }
+                        }
+                }
+                if (item == NO_ITEM) {
+                        break;
+                }
+                const struct int_inst *ii = me.ii;
+                if (ii != NULL) {
+                        const double scale = ii->scale;
+                        sol->bin_load[to] = (nearbyint(sol->bin_load[to]
+                                                       * scale)
+                                             + ii->sizes[item]) / scale;
+                        sol->bin_load[from] = (nearbyint(sol->bin_load[from]
+                                                         * scale)
+                                               - ii->sizes[item]) / scale;
+                } else {
+                        sol->bin_load[to] += prob_inst[item];
+                        sol->bin_load[from] -= prob_inst[item];
+                }
+                sol->item_bin[item] = to;
+                int num_bins = sol->num_bins;
+                if (sol->bin_start[from + 1] - sol->bin_start[from] == 1) {
+                        /* from is left empty; the bins after it close up */
+                        for (size_t i = 0; i < inst_sz; i++) {
+                                if (sol->item_bin[i] > from) {
+                                        sol->item_bin[i]--;
+                                }
+                        }
+                        memmove(sol->bin_load + from,
+                                sol->bin_load + from + 1,
+                                (num_bins - from - 1)
+                                * sizeof(*sol->bin_load));
+                        num_bins--;
+                }
+                memcpy(order, sol->items, inst_sz * sizeof(*order));
+                solution_regroup(sol, num_bins, inst_sz, order);
+                num_moves++;
+        }
+        arena_release(arena, mark);
+        return num_moves > 0;
+}
+static void bins_pick_emptied(bool *is_emptied,
+                              const double *load,
+                              int num_bins) {
+        int least = 0;
+        for (int j = 1; j < num_bins; j++) {
+                if (load[j] < load[least]) {
+                        least = j;
+                }
+        }
+        is_emptied[least] = true;
+        const int num_extra = rng_bounded(MAX_EXTRA_EMPTIED + 1);
+        for (int e = 0; (e < num_extra) && (e < num_bins - 2); e++) {
+                int j;
+                while (j = rng_bounded(num_bins), is_emptied[j]);
+                is_emptied[j] = true;
+        }
+}
+static bool repack_ffd(struct solution *sol,
+                       int num_bins,
+                       int max_bins,
+                       const size_t *free_items,
+                       size_t num_free,
+                       const size_t *order,
+                       const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap) {
+        struct arena *arena = arena_local();
+        const struct arena_mark mark = arena_mark(arena);
+        const struct int_inst *ii = int_inst_find(prob_inst, inst_sz,
+                                                  bin_cap);
+        const double cap = (ii != NULL) ? ii->cap : bin_cap;
+        double *load = arena_alloc(arena,
+                                   (num_bins + num_free) * sizeof(*load));
+        for (int j = 0; j < num_bins; j++) {
+                load[j] = 0.0;
+        }
+        for (size_t k = 0; k < inst_sz; k++) {
+                const size_t item = order[k];
+                if (sol->item_bin[item] >= 0) {
+                        load[sol->item_bin[item]] += (ii != NULL)
+                                                     ? ii->sizes[item]
+                                                     : prob_inst[item];
+                }
+        }
+        struct ffd_item *fr = arena_alloc(arena, num_free * sizeof(*fr));
+        for (size_t f = 0; f < num_free; f++) {
+                const size_t item = free_items[f];
+                fr[f] = (struct ffd_item){.size = (ii != NULL)
+                                                  ? ii->sizes[item]
+                                                  : prob_inst[item],
+                                          .item = item};
+        }
+        qsort(fr, num_free, sizeof(*fr), ffd_item_cmp);
+        int *bin_of = arena_alloc(arena, num_free * sizeof(*bin_of));
+        for (size_t f = 0; f < num_free; f++) {
+                int j = 0;
+                while ((j < num_bins) && (load[j] + fr[f].size > cap)) {
+                        j++;
+                }
+                if (j == num_bins) {
+                        load[num_bins++] = 0.0;
+                }
+                load[j] += fr[f].size;
+                bin_of[f] = j;
+        }
+        if (num_bins > max_bins) {
+                arena_release(arena, mark);
+                return false;
+        }
+        for (size_t f = 0; f < num_free; f++) {
+                sol->item_bin[fr[f].item] = bin_of[f];
+        }
+        solution_regroup(sol, num_bins, inst_sz, order);
+        for (int j = 0; j < num_bins; j++) {
+                sol->bin_load[j] = (ii != NULL) ? load[j] / ii->scale
+                                                : load[j];
+        }
+        arena_release(arena, mark);
+        return true;
+}
+static void group_repack(struct chromosome *chrom,
+                         int num_bins,
+                         const size_t *free_items,
+                         size_t num_free,
+                         const size_t *order,
+                         const double *prob_inst,
+                         size_t inst_sz,
+                         double bin_cap) {
+        repack_ffd(&chrom->sol, num_bins, INT_MAX, free_items, num_free,
+                   order, prob_inst, inst_sz, bin_cap);
+        memcpy(chrom->perm, chrom->sol.items,
+               inst_sz * sizeof(*chrom->perm));
+        chrom->hash = perm_hash(chrom->perm, inst_sz);
+        chrom->fitness = solution_eval(chrom->sol, bin_cap);
+        ff_checkpoints_invalidate(&chrom->cp);
+}
+/* larger first, then lower index */
+static int ffd_item_cmp(const void *a,
+                        const void *b) {
+        const struct ffd_item *fa = a;
+        const struct ffd_item *fb = b;
+        if (fa->size != fb->size) {
+                return (fa->size > fb->size) ? -1 : 1;
         }
+        return (fa->item > fb->item) - (fa->item < fb->item);
 }
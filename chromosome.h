@@ -2,12 +2,19 @@
 #define CHROMOSOME_H
 
 #include "bp-solution.h"
+#include "fitness-cache.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 struct chromosome {
         double fitness;
         size_t *perm;
+        /* perm_hash of perm, valid while fitness is */
+        uint64_t hash;
+        /* empty while fitness came from the cache; see chrom_decode */
         struct solution sol;
+        /* first-fit checkpoints along perm, for cheap local search */
+        struct ff_checkpoints cp;
 };
 struct bald_chrom {
         struct chromosome chrom;
@@ -18,16 +25,44 @@ void chrom_init(struct chromosome *chrom,
                 bool is_baldwinian);
 void chrom_destroy(struct chromosome *chrom,
                    bool is_baldwinian);
+/* cache may be NULL here and in chrom_search */
 void chrom_eval(struct chromosome *chrom,
+                struct fitness_cache *cache,
                 const double *prob_inst,
                 size_t inst_sz,
                 double bin_cap);
+/* decodes an evaluated chromosome whose solution was left empty */
+void chrom_decode(struct chromosome *chrom,
+                  const double *prob_inst,
+                  size_t inst_sz,
+                  double bin_cap);
 
 void chrom_mut(struct chromosome *chrom,
                size_t inst_sz);
-struct chromosome chrom_cx(struct chromosome parent1,
-                           struct chromosome parent2,
-                           size_t inst_sz);
+/* OX of the parents into child, which must already own perm storage for
+ * inst_sz items; the rest of child's storage is kept for reuse */
+void chrom_cx(struct chromosome *child,
+              struct chromosome parent1,
+              struct chromosome parent2,
+              size_t inst_sz);
+/* Falkenauer's grouping operators, which breed bins rather than
+ * permutations. Crossover puts a run of parent2's bins among parent1's,
+ * drops parent1's bins that share an item with them and puts the items
+ * this leaves out back first-fit decreasing; mutation empties the least
+ * filled bin and a few at random and repacks their items the same way.
+ * Parents must be decoded. The chromosome bred comes out evaluated from
+ * its bins, without a decode, and perm lists its items bin by bin so
+ * that first-fit packs it into as many bins or fewer. */
+void chrom_group_cx(struct chromosome *child,
+                    struct chromosome parent1,
+                    struct chromosome parent2,
+                    const double *prob_inst,
+                    size_t inst_sz,
+                    double bin_cap);
+void chrom_group_mut(struct chromosome *chrom,
+                     const double *prob_inst,
+                     size_t inst_sz,
+                     double bin_cap);
 
 struct search_flags {
         bool perm_modified : 1;
@@ -39,9 +74,11 @@ typedef struct search_flags (*chrom_search_func)(size_t *perm,
                                                  size_t inst_sz,
                                                  double bin_cap);
 
-/* returns number of searches conducted */
+/* returns number of searches conducted; neighbors the cache knows to be
+ * no better are rejected without decoding */
 int chrom_search(struct chromosome *chrom,
                  bool is_baldwinian,
+                 struct fitness_cache *cache,
                  const double *prob_inst,
                  size_t inst_sz,
                  double bin_cap,
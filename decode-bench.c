@@ -0,0 +1,189 @@
+#include "bp-solution.h"
+#include "int-inst.h"
+#include "ff-scan.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_DECODES 200
+#define MAX_CONFIGS     (FF_NUM_ISAS + 1)
+
+/* the linear decoder once per scan kernel the cpu supports, then the
+ * tree decoder, which does not scan */
+struct config {
+        enum first_fit_impl impl;
+        enum ff_isa isa;
+        char name[32];
+};
+
+static size_t configs_init(struct config *configs);
+static double now(void);
+static void perm_shuffle(size_t *perm,
+                         size_t perm_sz);
+
+/* Decodes random permutations of every problem read from stdin with each
+ * first-fit implementation and scan kernel, checks they agree and prints
+ * decodes/sec. Each problem is timed in integer units, if it has them,
+ * and in doubles. */
+int main(int argc, char **argv) {
+        int num_decodes = DEFAULT_DECODES;
+        if (argc > 1) {
+                num_decodes = atoi(argv[1]);
+                if (num_decodes < 1) {
+                        fprintf(stderr, "bad number of decodes: %s\n",
+                                argv[1]);
+                        return -1;
+                }
+        }
+        size_t num_problems;
+        if (scanf(" %zu", &num_problems) != 1) {
+                fprintf(stderr, "bad input\n");
+                return -1;
+        }
+        struct config configs[MAX_CONFIGS];
+        const size_t num_configs = configs_init(configs);
+        printf("problem\titems\tsizes\tbins");
+        for (size_t k = 0; k < num_configs; k++) {
+                printf("\t%s/s", configs[k].name);
+        }
+        printf("\n");
+
+        for (size_t p = 0; p < num_problems; p++) {
+                double bin_cap;
+                size_t inst_sz, optimal_num_bins;
+                if (scanf(" %*s %lf %zu %zu",
+                          &bin_cap, &inst_sz, &optimal_num_bins) != 3) {
+                        fprintf(stderr, "bad input\n");
+                        return -1;
+                }
+                double *prob_inst = malloc(inst_sz * sizeof(*prob_inst));
+                size_t *perms = malloc(num_decodes * inst_sz
+                                       * sizeof(*perms));
+                if ((prob_inst == NULL) || (perms == NULL)) {
+                        abort();
+                }
+                for (size_t i = 0; i < inst_sz; i++) {
+                        scanf(" %lf", prob_inst + i);
+                }
+                rng_seed_key(1, p);
+                for (int d = 0; d < num_decodes; d++) {
+                        size_t *perm = perms + (d * inst_sz);
+                        for (size_t i = 0; i < inst_sz; i++) {
+                                perm[i] = i;
+                        }
+                        perm_shuffle(perm, inst_sz);
+                }
+
+                struct solution ref, sol;
+                solution_init(&ref);
+                solution_init(&sol);
+                for (int is_int = 1; is_int >= 0; is_int--) {
+                        if (is_int && !int_inst_register(prob_inst, inst_sz,
+                                                         bin_cap)) {
+                                continue;
+                        }
+                        double rates[MAX_CONFIGS];
+                        int num_bins = 0;
+                        for (size_t k = 0; k < num_configs; k++) {
+                                ff_scan_select(configs[k].isa);
+                                /* warm up storage and scratch */
+                                solution_first_fit_with(configs[k].impl,
+                                                        &sol, prob_inst,
+                                                        inst_sz, perms,
+                                                        bin_cap);
+                                const double start = now();
+                                for (int d = 0; d < num_decodes; d++) {
+                                        solution_first_fit_with(
+                                                configs[k].impl, &sol,
+                                                prob_inst, inst_sz,
+                                                perms + (d * inst_sz),
+                                                bin_cap);
+                                        num_bins += sol.num_bins;
+                                }
+                                rates[k] = num_decodes / (now() - start);
+                        }
+
+                        /* every configuration must pack the same way */
+                        for (size_t k = 1; k < num_configs; k++) {
+                                for (int d = 0; d < num_decodes; d++) {
+                                        const size_t *perm = perms
+                                                             + (d * inst_sz);
+                                        ff_scan_select(configs[0].isa);
+                                        solution_first_fit_with(
+                                                configs[0].impl, &ref,
+                                                prob_inst, inst_sz, perm,
+                                                bin_cap);
+                                        ff_scan_select(configs[k].isa);
+                                        solution_first_fit_with(
+                                                configs[k].impl, &sol,
+                                                prob_inst, inst_sz, perm,
+                                                bin_cap);
+                                        if ((ref.num_bins != sol.num_bins)
+                                            || (memcmp(ref.items, sol.items,
+                                                       inst_sz
+                                                       * sizeof(*ref.items))
+                                                != 0)) {
+                                                fprintf(stderr, "%s disagrees "
+                                                        "with %s on problem "
+                                                        "%zu\n",
+                                                        configs[k].name,
+                                                        configs[0].name, p);
+                                                return -1;
+                                        }
+                                }
+                        }
+                        if (is_int) {
+                                int_inst_unregister(prob_inst);
+                        }
+
+                        printf("%zu\t%zu\t%s\t%.1lf", p, inst_sz,
+                               (is_int) ? "int" : "double",
+                               (double)num_bins
+                               / (num_decodes * num_configs));
+                        for (size_t k = 0; k < num_configs; k++) {
+                                printf("\t%.0lf", rates[k]);
+                        }
+                        printf("\n");
+                }
+                solution_destroy(ref);
+                solution_destroy(sol);
+                free(perms);
+                free(prob_inst);
+        }
+        return 0;
+}
+
+static size_t configs_init(struct config *configs) {
+        size_t num = 0;
+        for (int isa = 0; isa < FF_NUM_ISAS; isa++) {
+                if (!ff_isa_supported(isa)) {
+                        continue;
+                }
+                configs[num].impl = FIRST_FIT_LINEAR;
+                configs[num].isa = isa;
+                snprintf(configs[num].name, sizeof(configs[num].name),
+                         "linear-%s", ff_isa_name(isa));
+                num++;
+        }
+        configs[num].impl = FIRST_FIT_TREE;
+        configs[num].isa = ff_scan_selected();
+        snprintf(configs[num].name, sizeof(configs[num].name), "tree");
+        return num + 1;
+}
+static double now(void) {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + (t.tv_nsec / 1000000000.0);
+}
+/* Fisher-Yates */
+static void perm_shuffle(size_t *perm,
+                         size_t perm_sz) {
+        for (size_t i = perm_sz - 1; i > 0; i--) {
+                size_t j = rng_bounded(i + 1);
+                size_t tmp = perm[i];
+                perm[i] = perm[j];
+                perm[j] = tmp;
+        }
+}
@@ -0,0 +1,246 @@
+#include "ff-scan.h"
+#include <stdatomic.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+static int scan_int_scalar(const uint32_t *load,
+                           int num_bins,
+                           uint32_t max_load);
+static int scan_dbl_scalar(const double *load,
+                           int num_bins,
+                           double item,
+                           double bin_cap);
+#ifdef HAVE_X86_KERNELS
+static int scan_int_sse2(const uint32_t *load,
+                         int num_bins,
+                         uint32_t max_load);
+static int scan_dbl_sse2(const double *load,
+                         int num_bins,
+                         double item,
+                         double bin_cap);
+static int scan_int_avx2(const uint32_t *load,
+                         int num_bins,
+                         uint32_t max_load);
+static int scan_dbl_avx2(const double *load,
+                         int num_bins,
+                         double item,
+                         double bin_cap);
+static int scan_int_avx512(const uint32_t *load,
+                           int num_bins,
+                           uint32_t max_load);
+static int scan_dbl_avx512(const double *load,
+                           int num_bins,
+                           double item,
+                           double bin_cap);
+#endif
+static enum ff_isa isa_best(void);
+
+static const struct {
+        const char *name;
+        ff_scan_int_func scan_int;
+        ff_scan_dbl_func scan_dbl;
+} KERNELS[FF_NUM_ISAS] = {
+        [FF_ISA_SCALAR] = {"scalar", scan_int_scalar, scan_dbl_scalar},
+#ifdef HAVE_X86_KERNELS
+        [FF_ISA_SSE2] = {"sse2", scan_int_sse2, scan_dbl_sse2},
+        [FF_ISA_AVX2] = {"avx2", scan_int_avx2, scan_dbl_avx2},
+        [FF_ISA_AVX512] = {"avx512", scan_int_avx512, scan_dbl_avx512}
+#else
+        [FF_ISA_SSE2] = {"sse2", NULL, NULL},
+        [FF_ISA_AVX2] = {"avx2", NULL, NULL},
+        [FF_ISA_AVX512] = {"avx512", NULL, NULL}
+#endif
+};
+
+/* -1 until the first use resolves it; racing resolutions agree */
+static atomic_int selected = -1;
+
+const char *ff_isa_name(enum ff_isa isa) {
+        return KERNELS[isa].name;
+}
+bool ff_isa_supported(enum ff_isa isa) {
+        switch (isa) {
+                case FF_ISA_SCALAR:
+                        return true;
+#ifdef HAVE_X86_KERNELS
+                case FF_ISA_SSE2:
+                        return __builtin_cpu_supports("sse2");
+                case FF_ISA_AVX2:
+                        return __builtin_cpu_supports("avx2");
+                case FF_ISA_AVX512:
+                        return __builtin_cpu_supports("avx512f");
+#endif
+                default:
+                        return false;
+        }
+}
+bool ff_scan_select(enum ff_isa isa) {
+        if (!ff_isa_supported(isa)) {
+                return false;
+        }
+        atomic_store_explicit(&selected, isa, memory_order_relaxed);
+        return true;
+}
+enum ff_isa ff_scan_selected(void) {
+        int isa = atomic_load_explicit(&selected, memory_order_relaxed);
+        if (isa < 0) {
+                isa = isa_best();
+                atomic_store_explicit(&selected, isa, memory_order_relaxed);
+        }
+        return isa;
+}
+ff_scan_int_func ff_scan_int(void) {
+        return KERNELS[ff_scan_selected()].scan_int;
+}
+ff_scan_dbl_func ff_scan_dbl(void) {
+        return KERNELS[ff_scan_selected()].scan_dbl;
+}
+
+static enum ff_isa isa_best(void) {
+        for (int isa = FF_NUM_ISAS - 1; isa > FF_ISA_SCALAR; isa--) {
+                if (ff_isa_supported(isa)) {
+                        return isa;
+                }
+        }
+        return FF_ISA_SCALAR;
+}
+
+static int scan_int_scalar(const uint32_t *load,
+                           int num_bins,
+                           uint32_t max_load) {
+        int j = 0;
+        while ((j < num_bins) && (load[j] > max_load)) {
+                j++;
+        }
+        return j;
+}
+static int scan_dbl_scalar(const double *load,
+                           int num_bins,
+                           double item,
+                           double bin_cap) {
+        int j = 0;
+        while ((j < num_bins) && !(load[j] + item <= bin_cap)) {
+                j++;
+        }
+        return j;
+}
+
+#ifdef HAVE_X86_KERNELS
+/* The vector kernels look for the first lane that is not full. Loads are
+ * at most INT32_MAX, so the signed compares of SSE2 and AVX2 are exact;
+ * the doubles are added lane by lane exactly as the scalar loop adds them.
+ * The remainder of the array goes through the scalar loop, or through a
+ * masked load for AVX-512. */
+__attribute__((target("sse2")))
+static int scan_int_sse2(const uint32_t *load,
+                         int num_bins,
+                         uint32_t max_load) {
+        const __m128i max = _mm_set1_epi32(max_load);
+        int j = 0;
+        for (; j + 4 <= num_bins; j += 4) {
+                const __m128i v = _mm_loadu_si128((const __m128i *)(load + j));
+                const int full = _mm_movemask_ps(
+                                _mm_castsi128_ps(_mm_cmpgt_epi32(v, max)));
+                if (full != 0xf) {
+                        return j + __builtin_ctz(~full);
+                }
+        }
+        return j + scan_int_scalar(load + j, num_bins - j, max_load);
+}
+__attribute__((target("sse2")))
+static int scan_dbl_sse2(const double *load,
+                         int num_bins,
+                         double item,
+                         double bin_cap) {
+        const __m128d add = _mm_set1_pd(item);
+        const __m128d cap = _mm_set1_pd(bin_cap);
+        int j = 0;
+        for (; j + 2 <= num_bins; j += 2) {
+                const __m128d v = _mm_add_pd(_mm_loadu_pd(load + j), add);
+                const int fits = _mm_movemask_pd(_mm_cmple_pd(v, cap));
+                if (fits != 0) {
+                        return j + __builtin_ctz(fits);
+                }
+        }
+        return j + scan_dbl_scalar(load + j, num_bins - j, item, bin_cap);
+}
+__attribute__((target("avx2")))
+static int scan_int_avx2(const uint32_t *load,
+                         int num_bins,
+                         uint32_t max_load) {
+        const __m256i max = _mm256_set1_epi32(max_load);
+        int j = 0;
+        for (; j + 8 <= num_bins; j += 8) {
+                const __m256i v = _mm256_loadu_si256((const __m256i *)
+                                                     (load + j));
+                const int full = _mm256_movemask_ps(
+                                _mm256_castsi256_ps(_mm256_cmpgt_epi32(v,
+                                                                       max)));
+                if (full != 0xff) {
+                        return j + __builtin_ctz(~full);
+                }
+        }
+        return j + scan_int_scalar(load + j, num_bins - j, max_load);
+}
+__attribute__((target("avx2")))
+static int scan_dbl_avx2(const double *load,
+                         int num_bins,
+                         double item,
+                         double bin_cap) {
+        const __m256d add = _mm256_set1_pd(item);
+        const __m256d cap = _mm256_set1_pd(bin_cap);
+        int j = 0;
+        for (; j + 4 <= num_bins; j += 4) {
+                const __m256d v = _mm256_add_pd(_mm256_loadu_pd(load + j),
+                                                add);
+                const int fits = _mm256_movemask_pd(
+                                _mm256_cmp_pd(v, cap, _CMP_LE_OQ));
+                if (fits != 0) {
+                        return j + __builtin_ctz(fits);
+                }
+        }
+        return j + scan_dbl_scalar(load + j, num_bins - j, item, bin_cap);
+}
+__attribute__((target("avx512f")))
+static int scan_int_avx512(const uint32_t *load,
+                           int num_bins,
+                           uint32_t max_load) {
+        const __m512i max = _mm512_set1_epi32(max_load);
+        for (int j = 0; j < num_bins; j += 16) {
+                const __mmask16 lanes = (num_bins - j >= 16)
+                                        ? 0xffff
+                                        : (1u << (num_bins - j)) - 1;
+                const __m512i v = _mm512_maskz_loadu_epi32(lanes, load + j);
+                const __mmask16 fits = _mm512_mask_cmple_epu32_mask(lanes, v,
+                                                                    max);
+                if (fits != 0) {
+                        return j + __builtin_ctz(fits);
+                }
+        }
+        return num_bins;
+}
+__attribute__((target("avx512f")))
+static int scan_dbl_avx512(const double *load,
+                           int num_bins,
+                           double item,
+                           double bin_cap) {
+        const __m512d add = _mm512_set1_pd(item);
+        const __m512d cap = _mm512_set1_pd(bin_cap);
+        for (int j = 0; j < num_bins; j += 8) {
+                const __mmask8 lanes = (num_bins - j >= 8)
+                                       ? 0xff
+                                       : (1u << (num_bins - j)) - 1;
+                const __m512d v = _mm512_add_pd(
+                                _mm512_maskz_loadu_pd(lanes, load + j), add);
+                const __mmask8 fits = _mm512_mask_cmp_pd_mask(lanes, v, cap,
+                                                              _CMP_LE_OQ);
+                if (fits != 0) {
+                        return j + __builtin_ctz(fits);
+                }
+        }
+        return num_bins;
+}
+#endif /* HAVE_X86_KERNELS */
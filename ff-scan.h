@@ -0,0 +1,39 @@
+#ifndef FF_SCAN_H
+#define FF_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The first-fit inner loop: find the first bin an item fits in. Each ISA
+ * has a kernel comparing several bin loads per instruction; all return
+ * the same index as the scalar loop. The best kernel the CPU supports is
+ * picked on first use. */
+enum ff_isa {
+        FF_ISA_SCALAR,
+        FF_ISA_SSE2,
+        FF_ISA_AVX2,
+        FF_ISA_AVX512,
+        FF_NUM_ISAS
+};
+/* first j < num_bins with load[j] <= max_load, or num_bins; every load
+ * and max_load must be at most INT32_MAX */
+typedef int (*ff_scan_int_func)(const uint32_t *load,
+                                int num_bins,
+                                uint32_t max_load);
+/* first j < num_bins with load[j] + item <= bin_cap, or num_bins */
+typedef int (*ff_scan_dbl_func)(const double *load,
+                                int num_bins,
+                                double item,
+                                double bin_cap);
+
+const char *ff_isa_name(enum ff_isa isa);
+bool ff_isa_supported(enum ff_isa isa);
+/** Forces the kernels returned from now on, for the whole process.
+ * Returns false, changing nothing, if the CPU lacks isa */
+bool ff_scan_select(enum ff_isa isa);
+enum ff_isa ff_scan_selected(void);
+ff_scan_int_func ff_scan_int(void);
+ff_scan_dbl_func ff_scan_dbl(void);
+
+#endif /* !FF_SCAN_H */
@@ -0,0 +1,106 @@
+#include "fitness-cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+static inline uint64_t zobrist(size_t pos,
+                               size_t item);
+static inline uint64_t mix64(uint64_t x);
+
+uint64_t perm_hash(const size_t *perm,
+                   size_t perm_sz) {
+        uint64_t hash = 0;
+        for (size_t i = 0; i < perm_sz; i++) {
+                hash ^= zobrist(i, perm[i]);
+        }
+        return hash;
+}
+uint64_t perm_hash_update(uint64_t hash,
+                          const size_t *old_perm,
+                          const size_t *new_perm,
+                          size_t from,
+                          size_t perm_sz) {
+        for (size_t i = from; i < perm_sz; i++) {
+                if (old_perm[i] != new_perm[i]) {
+                        hash ^= zobrist(i, old_perm[i])
+                                ^ zobrist(i, new_perm[i]);
+                }
+        }
+        return hash;
+}
+
+void fitness_cache_init(struct fitness_cache *cache,
+                        int bits) {
+        const size_t num_entries = (size_t)1 << bits;
+        cache->mask = num_entries - 1;
+        /* zeroed slots fail the check for every hash but 0 */
+        cache->entries = calloc(num_entries, sizeof(*cache->entries));
+        if (cache->entries == NULL) {
+                abort();
+        }
+        atomic_init(&cache->hits, 0);
+        atomic_init(&cache->misses, 0);
+}
+void fitness_cache_destroy(struct fitness_cache *cache) {
+        free(cache->entries);
+        cache->entries = NULL;
+}
+bool fitness_cache_find(struct fitness_cache *cache,
+                        uint64_t hash,
+                        double *fitness,
+                        int *num_bins) {
+        if (cache == NULL) {
+                return false;
+        }
+        struct fitness_cache_entry *entry = cache->entries
+                                            + (hash & cache->mask);
+        const uint64_t check = atomic_load_explicit(&entry->check,
+                                                    memory_order_relaxed);
+        const uint64_t fit_bits = atomic_load_explicit(&entry->fitness,
+                                                       memory_order_relaxed);
+        const uint64_t bins = atomic_load_explicit(&entry->num_bins,
+                                                   memory_order_relaxed);
+        if ((hash == 0) || ((check ^ fit_bits ^ bins) != hash)) {
+                atomic_fetch_add_explicit(&cache->misses, 1,
+                                          memory_order_relaxed);
+                return false;
+        }
+        atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+        memcpy(fitness, &fit_bits, sizeof(*fitness));
+        *num_bins = bins;
+        return true;
+}
+void fitness_cache_store(struct fitness_cache *cache,
+                         uint64_t hash,
+                         double fitness,
+                         int num_bins) {
+        if (cache == NULL) {
+                return;
+        }
+        struct fitness_cache_entry *entry = cache->entries
+                                            + (hash & cache->mask);
+        uint64_t fit_bits;
+        memcpy(&fit_bits, &fitness, sizeof(fit_bits));
+        const uint64_t bins = num_bins;
+        atomic_store_explicit(&entry->fitness, fit_bits,
+                              memory_order_relaxed);
+        atomic_store_explicit(&entry->num_bins, bins, memory_order_relaxed);
+        atomic_store_explicit(&entry->check, hash ^ fit_bits ^ bins,
+                              memory_order_relaxed);
+}
+void fitness_cache_stats_take(struct fitness_cache *cache,
+                              size_t *hits,
+                              size_t *misses) {
+        *hits = atomic_exchange(&cache->hits, 0);
+        *misses = atomic_exchange(&cache->misses, 0);
+}
+
+/* splitmix64 finalizer over the pair */
+static inline uint64_t zobrist(size_t pos,
+                               size_t item) {
+        return mix64(((uint64_t)pos << 32) ^ item ^ 0x9e3779b97f4a7c15u);
+}
+static inline uint64_t mix64(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9u;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebu;
+        return x ^ (x >> 31);
+}
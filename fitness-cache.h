@@ -0,0 +1,57 @@
+#ifndef FITNESS_CACHE_H
+#define FITNESS_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Zobrist-style hash of a permutation: the xor over every position of a
+ * mix of (position, item), so changing a few positions only touches
+ * those terms. */
+uint64_t perm_hash(const size_t *perm,
+                   size_t perm_sz);
+/* hash of new_perm given the hash of old_perm, where the two are equal
+ * before position from */
+uint64_t perm_hash_update(uint64_t hash,
+                          const size_t *old_perm,
+                          const size_t *new_perm,
+                          size_t from,
+                          size_t perm_sz);
+
+/* Fixed-size, direct-mapped table from permutation hash to fitness and
+ * bin count, shared by every thread of a run without locks. Each slot
+ * stores its fields with relaxed atomics next to a check word, the xor
+ * of the hash and both fields; a read torn by a concurrent store fails
+ * the check and counts as a miss. Newer entries overwrite older ones.
+ * Permutations are only told apart by their 64-bit hash. */
+struct fitness_cache_entry {
+        _Atomic uint64_t check;
+        _Atomic uint64_t fitness;
+        _Atomic uint64_t num_bins;
+};
+struct fitness_cache {
+        size_t mask;
+        struct fitness_cache_entry *entries;
+        atomic_size_t hits;
+        atomic_size_t misses;
+};
+/* 2^bits entries */
+void fitness_cache_init(struct fitness_cache *cache,
+                        int bits);
+void fitness_cache_destroy(struct fitness_cache *cache);
+/** cache may be NULL, which finds nothing and counts nothing */
+bool fitness_cache_find(struct fitness_cache *cache,
+                        uint64_t hash,
+                        double *fitness,
+                        int *num_bins);
+void fitness_cache_store(struct fitness_cache *cache,
+                         uint64_t hash,
+                         double fitness,
+                         int num_bins);
+/* lookups since the last call */
+void fitness_cache_stats_take(struct fitness_cache *cache,
+                              size_t *hits,
+                              size_t *misses);
+
+#endif /* !FITNESS_CACHE_H */
@@ -0,0 +1,824 @@
+#include "bin-packing.h"
+#include "prob-set.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MAX_CONFIGS             16
+#define MAX_NAME                48
+#define DEFAULT_TRIALS          3
+#define DEFAULT_THREADS         4
+/* relative change in a timed figure that compare takes for noise */
+#define DEFAULT_THRESHOLD       0.1
+/* compare gates on timed figures only given this many trials a problem,
+ * ignores times differing by less than TIME_FLOOR seconds, and rates of
+ * runs whose median lasts less than RATE_MIN_ELAPSED */
+#define MIN_TIMED_TRIALS        3
+#define TIME_FLOOR              0.005
+#define RATE_MIN_ELAPSED        0.1
+#define MAX_LINE                1024
+
+/* an engine and a local search, named ENGINE/SEARCH after main's
+ * engine= option and fourth argument, such as group/DOMINANCE; a search
+ * of NONE mutates instead */
+struct config {
+        char name[MAX_NAME];
+        ga_engine_func engine;
+        bool use_local_search;
+        enum search_type search;
+};
+/* one trial of one config on one problem; times are in seconds, and -1
+ * when the run never reached the optimum */
+struct record {
+        char config[MAX_NAME];
+        char set[MAX_NAME];
+        size_t problem;
+        size_t trial;
+        size_t seed;
+        size_t items;
+        size_t optimum;
+        size_t stop_bins;
+        size_t bins;
+        double gap;
+        size_t gens;
+        double elapsed;
+        double time_to_best;
+        double time_to_optimum;
+        double gens_per_sec;
+        size_t decodes;
+        double decodes_per_sec;
+};
+enum field_type {
+        FIELD_STR,
+        FIELD_SIZE,
+        FIELD_DOUBLE,
+        /* a double that is null when negative */
+        FIELD_TIME
+};
+struct field {
+        const char *name;
+        enum field_type type;
+        size_t offset;
+};
+/* the columns of either format, in order */
+#define FIELD(NAME, TYPE) {#NAME, TYPE, offsetof(struct record, NAME)}
+static const struct field FIELDS[] = {
+        FIELD(config, FIELD_STR),
+        FIELD(set, FIELD_STR),
+        FIELD(problem, FIELD_SIZE),
+        FIELD(trial, FIELD_SIZE),
+        FIELD(seed, FIELD_SIZE),
+        FIELD(items, FIELD_SIZE),
+        FIELD(optimum, FIELD_SIZE),
+        FIELD(stop_bins, FIELD_SIZE),
+        FIELD(bins, FIELD_SIZE),
+        FIELD(gap, FIELD_DOUBLE),
+        FIELD(gens, FIELD_SIZE),
+        FIELD(elapsed, FIELD_DOUBLE),
+        FIELD(time_to_best, FIELD_DOUBLE),
+        FIELD(time_to_optimum, FIELD_TIME),
+        FIELD(gens_per_sec, FIELD_DOUBLE),
+        FIELD(decodes, FIELD_SIZE),
+        FIELD(decodes_per_sec, FIELD_DOUBLE)
+};
+#undef FIELD
+#define NUM_FIELDS      (sizeof(FIELDS) / sizeof(*FIELDS))
+
+enum format {
+        FORMAT_JSON,
+        FORMAT_CSV
+};
+struct bench_opts {
+        size_t trials;
+        size_t seed;
+        size_t threads;
+        int max_generations;
+        double max_time;
+        /* the first problems of each file, or SIZE_MAX for all */
+        size_t max_problems;
+        bool use_known_optimum;
+        enum format format;
+        struct config configs[MAX_CONFIGS];
+        size_t num_configs;
+};
+/* a timed figure of every run, for its median */
+struct samples {
+        double *vals;
+        size_t num;
+        size_t cap;
+};
+/* what compare weighs of one config on one set, over every problem and
+ * trial */
+struct summary {
+        char config[MAX_NAME];
+        char set[MAX_NAME];
+        size_t runs;
+        size_t trials;
+        size_t reached;
+        double gap;
+        struct samples time_to_best;
+        /* of the runs that reached the optimum */
+        struct samples time_to_optimum;
+        struct samples elapsed;
+        struct samples gens_per_sec;
+        struct samples decodes_per_sec;
+};
+struct summaries {
+        struct summary *items;
+        size_t num;
+        size_t cap;
+};
+
+static int bench_run(int argc,
+                     char **argv);
+static int bench_compare(int argc,
+                         char **argv);
+static int parse_option(struct bench_opts *opts,
+                        const char *arg);
+static bool parse_size(const char *str,
+                       size_t *out);
+static bool parse_config(struct config *config,
+                         const char *str);
+/* runs every config and trial on the problems of path */
+static int run_file(const struct bench_opts *opts,
+                    const char *path,
+                    FILE *null_out,
+                    bool *is_first);
+static void record_print(const struct record *rec,
+                         enum format format,
+                         bool is_first);
+/* the part of path after any directory and before any extension, with
+ * anything that could need quoting replaced by '_' */
+static void set_name(char *name,
+                     const char *path);
+/* adds the records of path to sums; returns 0, or -1 if it cannot be
+ * read or holds no record */
+static int summaries_read(struct summaries *sums,
+                          const char *path);
+static void summaries_add(struct summaries *sums,
+                          const struct record *rec);
+static const struct summary *summaries_find(const struct summaries *sums,
+                                            const char *config,
+                                            const char *set);
+static void summaries_free(struct summaries *sums);
+static void samples_add(struct samples *samples,
+                        double val);
+static int double_cmp(const void *a,
+                      const void *b);
+/* sorts samples in place; 0 if there are none */
+static double samples_median(struct samples *samples);
+/* splits a CSV line in place into at most max columns */
+static size_t csv_split(char *line,
+                        char **cols,
+                        size_t max);
+/* the text after "name": in a JSON line, or NULL */
+static const char *json_value(const char *line,
+                              const char *name);
+/* sets field f of rec from the start of text, which ends at a quote,
+ * comma, brace or the end of the line */
+static void field_parse(struct record *rec,
+                        const struct field *f,
+                        const char *text);
+/* prints one row of the comparison; returns whether it regressed. A
+ * figure worse by more than allowed is a regression if is_gated, and
+ * only marked as noise if not */
+static bool compare_row(const struct summary *old_sum,
+                        const char *metric,
+                        double old_val,
+                        double new_val,
+                        bool is_higher_better,
+                        double allowed,
+                        bool is_gated);
+
+/* Benchmarks the engines over OR-Library files with fixed seeds:
+ *   ga-bench.out run [name=value...] FILE...
+ * prints a record per config, problem and trial, as JSON or CSV, and
+ *   ga-bench.out compare OLD NEW [threshold=T]
+ * compares two such files, either format, config by config and set by
+ * set, flagging what got worse: any rise in the gap to the optimum or
+ * fall in the share of runs reaching it, as fixed seeds repeat, and any
+ * median timed figure worse by more than the threshold, a fraction, and
+ * by more than timer noise. Timed figures of fewer than MIN_TIMED_TRIALS
+ * trials are shown but never flagged. Exits 1 if anything regressed. */
+int main(int argc, char **argv) {
+        if ((argc >= 2) && (strcmp(argv[1], "run") == 0)) {
+                return bench_run(argc - 2, argv + 2);
+        } else if ((argc >= 2) && (strcmp(argv[1], "compare") == 0)) {
+                return bench_compare(argc - 2, argv + 2);
+        }
+        fprintf(stderr, "usage: %s run [name=value...] FILE...\n"
+                        "       %s compare OLD NEW [threshold=T]\n",
+                argv[0], argv[0]);
+        return -1;
+}
+
+static int bench_run(int argc,
+                     char **argv) {
+        struct bench_opts opts = {.trials = DEFAULT_TRIALS,
+                                  .seed = 1,
+                                  .threads = DEFAULT_THREADS,
+                                  .max_generations = 1000,
+                                  .max_time = DBL_MAX,
+                                  .max_problems = SIZE_MAX,
+                                  .use_known_optimum = true,
+                                  .format = FORMAT_JSON,
+                                  .num_configs = 0};
+        int num_files = 0;
+        for (int i = 0; i < argc; i++) {
+                if (strchr(argv[i], '=') == NULL) {
+                        num_files++;
+                } else if (parse_option(&opts, argv[i]) != 0) {
+                        return -1;
+                }
+        }
+        if (num_files == 0) {
+                fprintf(stderr, "no problem files\n");
+                return -1;
+        }
+        if (opts.num_configs == 0) {
+                parse_config(&opts.configs[0], "perm/SWAP_RAND");
+                opts.num_configs = 1;
+        }
+        FILE *null_out = fopen("/dev/null", "w");
+        if (null_out == NULL) {
+                abort();
+        }
+        if (opts.format == FORMAT_JSON) {
+                printf("[\n");
+        } else {
+                for (size_t f = 0; f < NUM_FIELDS; f++) {
+                        printf("%s%c", FIELDS[f].name,
+                               (f + 1 < NUM_FIELDS) ? ',' : '\n');
+                }
+        }
+        bool is_first = true;
+        int ret = 0;
+        for (int i = 0; (i < argc) && (ret == 0); i++) {
+                if (strchr(argv[i], '=') == NULL) {
+                        ret = run_file(&opts, argv[i], null_out, &is_first);
+                }
+        }
+        if (opts.format == FORMAT_JSON) {
+                printf("\n]\n");
+        }
+        fclose(null_out);
+        return ret;
+}
+static int bench_compare(int argc,
+                         char **argv) {
+        double threshold = DEFAULT_THRESHOLD;
+        if ((argc == 3) && (strncmp(argv[2], "threshold=", 10) == 0)) {
+                char *end;
+                threshold = strtod(argv[2] + 10, &end);
+                if ((*end != '\0') || !(threshold >= 0)) {
+                        fprintf(stderr, "bad threshold: %s\n", argv[2]);
+                        return -1;
+                }
+        } else if (argc != 2) {
+                fprintf(stderr, "compare needs OLD NEW [threshold=T]\n");
+                return -1;
+        }
+        struct summaries old_sums = {.items = NULL, .num = 0, .cap = 0};
+        struct summaries new_sums = {.items = NULL, .num = 0, .cap = 0};
+        if ((summaries_read(&old_sums, argv[0]) != 0)
+            || (summaries_read(&new_sums, argv[1]) != 0)) {
+                summaries_free(&old_sums);
+                summaries_free(&new_sums);
+                return -1;
+        }
+        printf("config\tset\tmetric\told\tnew\tchange\n");
+        size_t num_regressed = 0;
+        for (size_t i = 0; i < old_sums.num; i++) {
+                /* not const, as medians sort their samples */
+                struct summary *o = &old_sums.items[i];
+                struct summary *n = (struct summary *)summaries_find(
+                        &new_sums, o->config, o->set);
+                if (n == NULL) {
+                        printf("%s\t%s\tmissing from %s\n", o->config,
+                               o->set, argv[1]);
+                        continue;
+                }
+                num_regressed += compare_row(o, "gap", o->gap / o->runs,
+                                             n->gap / n->runs, false, 1e-9,
+                                             true);
+                num_regressed += compare_row(o, "optimal",
+                                             (double)o->reached / o->runs,
+                                             (double)n->reached / n->runs,
+                                             true, 1e-9, true);
+                /* untimed figures repeat for fixed seeds, so any change
+                 * counts; timed ones need trials to take a median of */
+                const bool is_timed_gated = (o->trials >= MIN_TIMED_TRIALS)
+                                            && (n->trials
+                                                >= MIN_TIMED_TRIALS);
+                const double old_best = samples_median(&o->time_to_best);
+                num_regressed += compare_row(
+                        o, "time_to_best", old_best,
+                        samples_median(&n->time_to_best), false,
+                        fmax(threshold * old_best, TIME_FLOOR),
+                        is_timed_gated);
+                if ((o->reached > 0) && (n->reached > 0)) {
+                        const double old_opt = samples_median(
+                                &o->time_to_optimum);
+                        num_regressed += compare_row(
+                                o, "time_to_optimum", old_opt,
+                                samples_median(&n->time_to_optimum), false,
+                                fmax(threshold * old_opt, TIME_FLOOR),
+                                is_timed_gated);
+                }
+                const bool is_rate_gated = is_timed_gated
+                        && (samples_median(&o->elapsed) >= RATE_MIN_ELAPSED)
+                        && (samples_median(&n->elapsed) >= RATE_MIN_ELAPSED);
+                const double old_gens = samples_median(&o->gens_per_sec);
+                num_regressed += compare_row(
+                        o, "gens_per_sec", old_gens,
+                        samples_median(&n->gens_per_sec), true,
+                        threshold * old_gens, is_rate_gated);
+                const double old_decodes = samples_median(
+                        &o->decodes_per_sec);
+                num_regressed += compare_row(
+                        o, "decodes_per_sec", old_decodes,
+                        samples_median(&n->decodes_per_sec), true,
+                        threshold * old_decodes, is_rate_gated);
+        }
+        for (size_t i = 0; i < new_sums.num; i++) {
+                const struct summary *n = &new_sums.items[i];
+                if (summaries_find(&old_sums, n->config, n->set) == NULL) {
+                        printf("%s\t%s\tmissing from %s\n", n->config,
+                               n->set, argv[0]);
+                }
+        }
+        printf("%zu regressions beyond %g\n", num_regressed, threshold);
+        summaries_free(&old_sums);
+        summaries_free(&new_sums);
+        return (num_regressed > 0) ? 1 : 0;
+}
+static int parse_option(struct bench_opts *opts,
+                        const char *arg) {
+        const char *val = strchr(arg, '=');
+        const size_t name_len = val - arg;
+        val++;
+        size_t num;
+#define IS_OPT(NAME) \
+        ((name_len == strlen(NAME)) && (strncmp(arg, NAME, name_len) == 0))
+        if (IS_OPT("trials") && parse_size(val, &num) && (num > 0)) {
+                opts->trials = num;
+        } else if (IS_OPT("seed") && parse_size(val, &num)) {
+                opts->seed = num;
+        } else if (IS_OPT("threads") && parse_size(val, &num) && (num > 0)
+                   && (num <= INT_MAX)) {
+                opts->threads = num;
+        } else if (IS_OPT("gens") && parse_size(val, &num) && (num > 0)
+                   && (num <= INT_MAX)) {
+                opts->max_generations = num;
+        } else if (IS_OPT("time") && parse_size(val, &num) && (num > 0)) {
+                opts->max_time = num;
+        } else if (IS_OPT("problems") && parse_size(val, &num)
+                   && (num > 0)) {
+                opts->max_problems = num;
+        } else if (IS_OPT("optimum") && (strcmp(val, "1") == 0)) {
+                opts->use_known_optimum = true;
+        } else if (IS_OPT("optimum") && (strcmp(val, "0") == 0)) {
+                opts->use_known_optimum = false;
+        } else if (IS_OPT("format") && (strcmp(val, "json") == 0)) {
+                opts->format = FORMAT_JSON;
+        } else if (IS_OPT("format") && (strcmp(val, "csv") == 0)) {
+                opts->format = FORMAT_CSV;
+        } else if (IS_OPT("config") && (opts->num_configs < MAX_CONFIGS)
+                   && parse_config(&opts->configs[opts->num_configs], val)) {
+                opts->num_configs++;
+        } else {
+                fprintf(stderr, "bad option: %s\n", arg);
+                return -1;
+        }
+#undef IS_OPT
+        return 0;
+}
+static bool parse_size(const char *str,
+                       size_t *out) {
+        char *end;
+        if ((*str < '0') || (*str > '9')) {
+                return false;
+        }
+        unsigned long long tmp = strtoull(str, &end, 10);
+        if ((*end != '\0') || (tmp > SIZE_MAX)) {
+                return false;
+        }
+        *out = tmp;
+        return true;
+}
+static bool parse_config(struct config *config,
+                         const char *str) {
+        const char *search = strchr(str, '/');
+        if ((search == NULL) || (strlen(str) >= MAX_NAME)) {
+                return false;
+        }
+        const size_t engine_len = search - str;
+        search++;
+        if ((engine_len == 4) && (strncmp(str, "perm", 4) == 0)) {
+                config->engine = genetic_algorithm;
+        } else if ((engine_len == 5) && (strncmp(str, "group", 5) == 0)) {
+                config->engine = grouping_genetic_algorithm;
+        } else {
+                return false;
+        }
+        config->use_local_search = true;
+        if (strcmp(search, "NONE") == 0) {
+                config->use_local_search = false;
+                config->search = NONE;
+        } else if (strcmp(search, "SWAP_RAND") == 0) {
+                config->search = SWAP_RAND;
+        } else if (strcmp(search, "SHUFFLE_GROUPS") == 0) {
+                config->search = SHUFFLE_GROUPS;
+        } else if (strcmp(search, "DOMINANCE") == 0) {
+                config->search = DOMINANCE;
+        } else {
+                return false;
+        }
+        strcpy(config->name, str);
+        return true;
+}
+static int run_file(const struct bench_opts *opts,
+                    const char *path,
+                    FILE *null_out,
+                    bool *is_first) {
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+                fprintf(stderr, "cannot open %s\n", path);
+                return -1;
+        }
+        struct prob_set set;
+        const int read_ret = prob_set_read(&set, fd);
+        close(fd);
+        if (read_ret != 0) {
+                fprintf(stderr, "malformed problem file %s\n", path);
+                return -1;
+        }
+        char name[MAX_NAME];
+        set_name(name, path);
+        const size_t num_problems = (set.num_problems < opts->max_problems)
+                                    ? set.num_problems : opts->max_problems;
+        for (size_t c = 0; c < opts->num_configs; c++) {
+                const struct config *config = &opts->configs[c];
+                for (size_t p = 0; p < num_problems; p++) {
+                        const struct problem *prob = &set.problems[p];
+                        for (size_t t = 0; t < opts->trials; t++) {
+                                struct ga_tuning tuning;
+                                struct ga_stats stats;
+                                ga_tuning_init(&tuning);
+                                tuning.seed = opts->seed + t;
+                                const size_t known_optimum
+                                        = (opts->use_known_optimum)
+                                          ? prob->optimal_num_bins : 0;
+                                struct solution sol = config->engine(
+                                        prob->prob_inst, prob->inst_sz,
+                                        prob->bin_cap, prob->lower_bound,
+                                        known_optimum, false,
+                                        SUCCESSIVE_MUT,
+                                        config->use_local_search,
+                                        config->search, LAMARCKIAN,
+                                        opts->threads,
+                                        opts->max_generations,
+                                        opts->max_time, null_out, &tuning,
+                                        &stats);
+                                solution_destroy(sol);
+
+                                struct record rec = {
+                                        .problem = p,
+                                        .trial = t,
+                                        .seed = tuning.seed,
+                                        .items = prob->inst_sz,
+                                        .optimum = prob->optimal_num_bins,
+                                        .stop_bins = stats.stop_bins,
+                                        .bins = stats.best_num_bins,
+                                        .gap = (double)stats.best_num_bins
+                                               - prob->optimal_num_bins,
+                                        .gens = stats.num_gens,
+                                        .elapsed = stats.elapsed,
+                                        .time_to_best = stats.time_to_best,
+                                        .time_to_optimum
+                                                = stats.time_to_stop,
+                                        .gens_per_sec = stats.num_gens
+                                                        / stats.elapsed,
+                                        .decodes = stats.num_decodes,
+                                        .decodes_per_sec
+                                                = stats.num_decodes
+                                                  / stats.elapsed};
+                                strcpy(rec.config, config->name);
+                                strcpy(rec.set, name);
+                                record_print(&rec, opts->format, *is_first);
+                                *is_first = false;
+                                fprintf(stderr, "%s %s #%zu trial %zu: %zu "
+                                                "bins of %zu in %lf s\n",
+                                        rec.config, rec.set, p, t, rec.bins,
+                                        rec.optimum, rec.elapsed);
+                        }
+                }
+        }
+        fflush(stdout);
+        prob_set_destroy(set);
+        return 0;
+}
+static void record_print(const struct record *rec,
+                         enum format format,
+                         bool is_first) {
+        const bool is_json = format == FORMAT_JSON;
+        if (is_json) {
+                printf("%s{", (is_first) ? "" : ",\n");
+        }
+        for (size_t f = 0; f < NUM_FIELDS; f++) {
+                const struct field *field = &FIELDS[f];
+                const void *at = (const char *)rec + field->offset;
+                if (is_json) {
+                        printf("%s\"%s\": ", (f > 0) ? ", " : "",
+                               field->name);
+                } else if (f > 0) {
+                        putchar(',');
+                }
+                switch (field->type) {
+                        case FIELD_STR:
+                                printf((is_json) ? "\"%s\"" : "%s",
+                                       (const char *)at);
+                                break;
+                        case FIELD_SIZE:
+                                printf("%zu", *(const size_t *)at);
+                                break;
+                        case FIELD_TIME:
+                                if (*(const double *)at < 0) {
+                                        fputs((is_json) ? "null" : "",
+                                              stdout);
+                                        break;
+                                }
+                                /* fall through */
+                        case FIELD_DOUBLE:
+                                printf("%.9g", *(const double *)at);
+                                break;
+                }
+        }
+        if (is_json) {
+                putchar('}');
+        } else {
+                putchar('\n');
+        }
+}
+static void set_name(char *name,
+                     const char *path) {
+        const char *base = strrchr(path, '/');
+        base = (base != NULL) ? base + 1 : path;
+        size_t len = strcspn(base, ".");
+        if (len >= MAX_NAME) {
+                len = MAX_NAME - 1;
+        }
+        for (size_t i = 0; i < len; i++) {
+                const char ch = base[i];
+                const bool is_plain = ((ch >= 'a') && (ch <= 'z'))
+                                      || ((ch >= 'A') && (ch <= 'Z'))
+                                      || ((ch >= '0') && (ch <= '9'))
+                                      || (ch == '-') || (ch == '_');
+                name[i] = (is_plain) ? ch : '_';
+        }
+        name[len] = '\0';
+}
+static int summaries_read(struct summaries *sums,
+                          const char *path) {
+        FILE *in = fopen(path, "r");
+        if (in == NULL) {
+                fprintf(stderr, "cannot open %s\n", path);
+                return -1;
+        }
+        char line[MAX_LINE];
+        /* for CSV, the field of each column, NULL if unknown */
+        const struct field *columns[NUM_FIELDS * 2];
+        size_t num_columns = 0;
+        bool is_csv = false;
+        bool is_first = true;
+        size_t num_records = 0;
+        while (fgets(line, sizeof(line), in) != NULL) {
+                const char *start = line + strspn(line, " \t");
+                if (is_first && (*start != '[') && (*start != '{')) {
+                        /* a CSV header */
+                        is_csv = true;
+                        char *cols[NUM_FIELDS * 2];
+                        num_columns = csv_split(line, cols,
+                                                NUM_FIELDS * 2);
+                        for (size_t c = 0; c < num_columns; c++) {
+                                columns[c] = NULL;
+                                for (size_t f = 0; f < NUM_FIELDS; f++) {
+                                        if (strcmp(cols[c], FIELDS[f].name)
+                                            == 0) {
+                                                columns[c] = &FIELDS[f];
+                                        }
+                                }
+                        }
+                        is_first = false;
+                        continue;
+                }
+                is_first = false;
+                struct record rec;
+                memset(&rec, 0, sizeof(rec));
+                rec.time_to_optimum = -1;
+                if (is_csv) {
+                        char *cols[NUM_FIELDS * 2];
+                        const size_t n = csv_split(line, cols,
+                                                   NUM_FIELDS * 2);
+                        if (n != num_columns) {
+                                continue;
+                        }
+                        for (size_t c = 0; c < n; c++) {
+                                if (columns[c] != NULL) {
+                                        field_parse(&rec, columns[c],
+                                                    cols[c]);
+                                }
+                        }
+                } else if (*start == '{') {
+                        for (size_t f = 0; f < NUM_FIELDS; f++) {
+                                const char *val = json_value(start,
+                                                             FIELDS[f].name);
+                                if (val != NULL) {
+                                        field_parse(&rec, &FIELDS[f], val);
+                                }
+                        }
+                } else {
+                        continue;
+                }
+                summaries_add(sums, &rec);
+                num_records++;
+        }
+        fclose(in);
+        if (num_records == 0) {
+                fprintf(stderr, "no records in %s\n", path);
+                return -1;
+        }
+        return 0;
+}
+static void summaries_add(struct summaries *sums,
+                          const struct record *rec) {
+        struct summary *sum = (struct summary *)summaries_find(sums,
+                                                               rec->config,
+                                                               rec->set);
+        if (sum == NULL) {
+                if (sums->num == sums->cap) {
+                        sums->cap = (sums->cap > 0) ? 2 * sums->cap : 16;
+                        sums->items = realloc(sums->items,
+                                              sums->cap
+                                              * sizeof(*sums->items));
+                        if (sums->items == NULL) {
+                                abort();
+                        }
+                }
+                sum = &sums->items[sums->num++];
+                memset(sum, 0, sizeof(*sum));
+                strcpy(sum->config, rec->config);
+                strcpy(sum->set, rec->set);
+        }
+        sum->runs++;
+        if (rec->trial >= sum->trials) {
+                sum->trials = rec->trial + 1;
+        }
+        sum->gap += rec->gap;
+        samples_add(&sum->time_to_best, rec->time_to_best);
+        if (rec->time_to_optimum >= 0) {
+                sum->reached++;
+                samples_add(&sum->time_to_optimum, rec->time_to_optimum);
+        }
+        samples_add(&sum->elapsed, rec->elapsed);
+        samples_add(&sum->gens_per_sec, rec->gens_per_sec);
+        samples_add(&sum->decodes_per_sec, rec->decodes_per_sec);
+}
+static const struct summary *summaries_find(const struct summaries *sums,
+                                            const char *config,
+                                            const char *set) {
+        for (size_t i = 0; i < sums->num; i++) {
+                if ((strcmp(sums->items[i].config, config) == 0)
+                    && (strcmp(sums->items[i].set, set) == 0)) {
+                        return &sums->items[i];
+                }
+        }
+        return NULL;
+}
+static void summaries_free(struct summaries *sums) {
+        for (size_t i = 0; i < sums->num; i++) {
+                struct summary *sum = &sums->items[i];
+                free(sum->time_to_best.vals);
+                free(sum->time_to_optimum.vals);
+                free(sum->elapsed.vals);
+                free(sum->gens_per_sec.vals);
+                free(sum->decodes_per_sec.vals);
+        }
+        free(sums->items);
+}
+static void samples_add(struct samples *samples,
+                        double val) {
+        if (samples->num == samples->cap) {
+                samples->cap = (samples->cap > 0) ? 2 * samples->cap : 16;
+                samples->vals = realloc(samples->vals,
+                                        samples->cap
+                                        * sizeof(*samples->vals));
+                if (samples->vals == NULL) {
+                        abort();
+                }
+        }
+        samples->vals[samples->num++] = val;
+}
+static int double_cmp(const void *a,
+                      const void *b) {
+        const double x = *(const double *)a;
+        const double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+static double samples_median(struct samples *samples) {
+        const size_t n = samples->num;
+        if (n == 0) {
+                return 0;
+        }
+        qsort(samples->vals, n, sizeof(*samples->vals), double_cmp);
+        return (n % 2 == 1)
+               ? samples->vals[n / 2]
+               : (samples->vals[n / 2 - 1] + samples->vals[n / 2]) / 2;
+}
+static size_t csv_split(char *line,
+                        char **cols,
+                        size_t max) {
+        line[strcspn(line, "\r\n")] = '\0';
+        size_t n = 0;
+        while (n < max) {
+                cols[n++] = line;
+                line = strchr(line, ',');
+                if (line == NULL) {
+                        break;
+                }
+                *line++ = '\0';
+        }
+        return n;
+}
+static const char *json_value(const char *line,
+                              const char *name) {
+        const size_t len = strlen(name);
+        for (const char *at = strchr(line, '"'); at != NULL;
+             at = strchr(at + 1, '"')) {
+                if ((strncmp(at + 1, name, len) == 0)
+                    && (at[len + 1] == '"') && (at[len + 2] == ':')) {
+                        return at + len + 3 + strspn(at + len + 3, " ");
+                }
+        }
+        return NULL;
+}
+static void field_parse(struct record *rec,
+                        const struct field *f,
+                        const char *text) {
+        void *at = (char *)rec + f->offset;
+        switch (f->type) {
+                case FIELD_STR: {
+                        if (*text == '"') {
+                                text++;
+                        }
+                        size_t len = strcspn(text, "\",}\r\n");
+                        if (len >= MAX_NAME) {
+                                len = MAX_NAME - 1;
+                        }
+                        memcpy(at, text, len);
+                        ((char *)at)[len] = '\0';
+                        break;
+                }
+                case FIELD_SIZE:
+                        *(size_t *)at = strtoull(text, NULL, 10);
+                        break;
+                case FIELD_TIME:
+                        if ((*text == '\0') || (*text == 'n')) {
+                                *(double *)at = -1;
+                                break;
+                        }
+                        /* fall through */
+                case FIELD_DOUBLE:
+                        *(double *)at = strtod(text, NULL);
+                        break;
+        }
+}
+static bool compare_row(const struct summary *old_sum,
+                        const char *metric,
+                        double old_val,
+                        double new_val,
+                        bool is_higher_better,
+                        double allowed,
+                        bool is_gated) {
+        const double worse_by = (is_higher_better) ? old_val - new_val
+                                                   : new_val - old_val;
+        const bool is_worse = worse_by > allowed;
+        const bool is_regressed = is_worse && is_gated;
+        printf("%s\t%s\t%s\t%.6g\t%.6g\t", old_sum->config, old_sum->set,
+               metric, old_val, new_val);
+        if (old_val != 0) {
+                printf("%+.1f%%", 100 * (new_val - old_val) / old_val);
+        } else {
+                printf("%+.6g", new_val - old_val);
+        }
+        printf("%s\n", (is_regressed) ? "\tREGRESSION"
+                        : (is_worse) ? "\tnoise" : "");
+        return is_regressed;
+}
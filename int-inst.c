@@ -0,0 +1,134 @@
+#include "int-inst.h"
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MAX_REGISTERED  64
+
+static bool to_int(double val,
+                   double scale,
+                   uint32_t *out);
+
+/* readers scan keys without locking; an entry is filled in before its key
+ * is published */
+static _Atomic(const double *) keys[MAX_REGISTERED];
+static struct int_inst entries[MAX_REGISTERED];
+static int refs[MAX_REGISTERED];
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+bool int_inst_init(struct int_inst *restrict ii,
+                   const double *restrict prob_inst,
+                   size_t inst_sz,
+                   double bin_cap) {
+        uint32_t *sizes = malloc(inst_sz * sizeof(*sizes));
+        if (sizes == NULL) {
+                abort();
+        }
+        for (double scale = 1; scale <= INT_INST_MAX_SCALE; scale *= 10) {
+                uint32_t cap;
+                if (!to_int(bin_cap, scale, &cap)) {
+                        continue;
+                }
+                size_t i = 0;
+                while ((i < inst_sz) && to_int(prob_inst[i], scale,
+                                                sizes + i)) {
+                        i++;
+                }
+                if (i == inst_sz) {
+                        *ii = (struct int_inst){.prob_inst = prob_inst,
+                                                .inst_sz = inst_sz,
+                                                .bin_cap = bin_cap,
+                                                .sizes = sizes,
+                                                .cap = cap,
+                                                .scale = scale};
+                        return true;
+                }
+        }
+        free(sizes);
+        return false;
+}
+void int_inst_destroy(struct int_inst ii) {
+        free(ii.sizes);
+}
+uint64_t int_inst_sum(const struct int_inst *ii) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < ii->inst_sz; i++) {
+                sum += ii->sizes[i];
+        }
+        return sum;
+}
+
+bool int_inst_register(const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap) {
+        bool is_registered = false;
+        pthread_mutex_lock(&registry_lock);
+        int free_slot = -1;
+        for (int i = 0; i < MAX_REGISTERED; i++) {
+                const double *key = atomic_load(keys + i);
+                if (key == NULL) {
+                        if (free_slot < 0) {
+                                free_slot = i;
+                        }
+                } else if ((key == prob_inst)
+                           && (entries[i].inst_sz == inst_sz)
+                           && (entries[i].bin_cap == bin_cap)) {
+                        refs[i]++;
+                        is_registered = true;
+                        goto exit;
+                }
+        }
+        if ((free_slot >= 0)
+            && int_inst_init(entries + free_slot, prob_inst, inst_sz,
+                             bin_cap)) {
+                refs[free_slot] = 1;
+                atomic_store(keys + free_slot, prob_inst);
+                is_registered = true;
+        }
+
+exit:
+        pthread_mutex_unlock(&registry_lock);
+        return is_registered;
+}
+void int_inst_unregister(const double *prob_inst) {
+        pthread_mutex_lock(&registry_lock);
+        for (int i = 0; i < MAX_REGISTERED; i++) {
+                if (atomic_load(keys + i) != prob_inst) {
+                        continue;
+                }
+                refs[i]--;
+                if (refs[i] == 0) {
+                        atomic_store(keys + i, NULL);
+                        int_inst_destroy(entries[i]);
+                }
+                break;
+        }
+        pthread_mutex_unlock(&registry_lock);
+}
+const struct int_inst *int_inst_find(const double *prob_inst,
+                                     size_t inst_sz,
+                                     double bin_cap) {
+        for (int i = 0; i < MAX_REGISTERED; i++) {
+                if ((atomic_load_explicit(keys + i, memory_order_acquire)
+                     == prob_inst)
+                    && (entries[i].inst_sz == inst_sz)
+                    && (entries[i].bin_cap == bin_cap)) {
+                        return entries + i;
+                }
+        }
+        return NULL;
+}
+
+/* the integer must map back to exactly the same double */
+static bool to_int(double val,
+                   double scale,
+                   uint32_t *out) {
+        const double scaled = nearbyint(val * scale);
+        if (!(scaled >= 0) || (scaled > INT_INST_MAX)
+            || (scaled / scale != val)) {
+                return false;
+        }
+        *out = scaled;
+        return true;
+}
@@ -0,0 +1,50 @@
+#ifndef INT_INST_H
+#define INT_INST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* An instance whose sizes are all integers once scaled by a power of ten,
+ * as every OR-Library file is. sizes[i] / scale == prob_inst[i] and
+ * cap / scale == bin_cap exactly, and no size or capacity exceeds
+ * INT_INST_MAX so a load plus a size always fits in 32 bits. Packing in
+ * these units makes every capacity check exact. */
+#define INT_INST_MAX    (UINT32_MAX / 2)
+#define INT_INST_MAX_SCALE      10000
+
+struct int_inst {
+        const double *prob_inst;
+        size_t inst_sz;
+        double bin_cap;
+        uint32_t *sizes;
+        uint32_t cap;
+        double scale;
+};
+
+/** Returns false, leaving ii untouched, if the instance has no exact
+ * integer form */
+bool int_inst_init(struct int_inst *restrict ii,
+                   const double *restrict prob_inst,
+                   size_t inst_sz,
+                   double bin_cap);
+void int_inst_destroy(struct int_inst ii);
+/** exact sum of the scaled sizes */
+uint64_t int_inst_sum(const struct int_inst *ii);
+
+/** Process-wide table that lets the decoders find the integer form of an
+ * instance from its prob_inst pointer. Registering the same instance
+ * again only counts a reference. Returns false if the instance is not
+ * integral or the table is full, in which case decoding stays in
+ * doubles */
+bool int_inst_register(const double *prob_inst,
+                       size_t inst_sz,
+                       double bin_cap);
+/** Must not race with decodes of the same instance */
+void int_inst_unregister(const double *prob_inst);
+/** NULL if prob_inst was not registered with the same size and capacity */
+const struct int_inst *int_inst_find(const double *prob_inst,
+                                     size_t inst_sz,
+                                     double bin_cap);
+
+#endif /* !INT_INST_H */
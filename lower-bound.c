@@ -0,0 +1,284 @@
+#include "lower-bound.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <float.h>
+#include <math.h>
+
+/* number of leading entries of the decreasing sizes that exceed val */
+static size_t count_above(const uint32_t *sorted,
+                          size_t num,
+                          uint64_t val);
+/* L2 of the decreasing sizes in sorted; prefix is room for num + 1 */
+static size_t l2_sorted(const uint32_t *sorted,
+                        size_t num,
+                        uint64_t cap,
+                        uint64_t *prefix);
+/* One pass of Martello and Toth's reduction over the decreasing sizes
+ * in sorted, taking out the items of each bin that some optimal packing
+ * is sure to have. Returns the number of such bins and leaves the other
+ * items sorted at the front, num becoming their number. next and prev
+ * are room for num + 1 links. */
+static size_t reduce(uint32_t *sorted,
+                     size_t *num,
+                     uint64_t cap,
+                     size_t *next,
+                     size_t *prev);
+/* the first item left at or after pos, num if none */
+static size_t find_next(size_t *next,
+                        size_t pos);
+/* one more than the last item left before pos, 0 if none */
+static size_t find_prev(size_t *prev,
+                        size_t pos);
+struct sized_index {
+        double size;
+        uint32_t index;
+};
+static int order_cmp(const void *a,
+                     const void *b);
+
+size_t lower_bound_l1(const struct int_inst *ii) {
+        return (int_inst_sum(ii) + ii->cap - 1) / ii->cap;
+}
+size_t lower_bound_l1_double(const double *prob_inst,
+                             size_t inst_sz,
+                             double bin_cap) {
+        double sum = 0.0;
+        for (size_t i = 0; i < inst_sz; i++) {
+                sum += prob_inst[i];
+        }
+        /* allow for the rounding of the sum */
+        const double l1 = ceil(sum / bin_cap
+                               * (1 - (inst_sz + 2) * DBL_EPSILON));
+        return (l1 > 0) ? l1 : 0;
+}
+size_t lower_bound_l2(const struct int_inst *ii,
+                      const uint32_t *by_size) {
+        const size_t n = ii->inst_sz;
+        uint32_t *sorted = malloc(n * sizeof(*sorted));
+        uint64_t *prefix = malloc((n + 1) * sizeof(*prefix));
+        if (((sorted == NULL) && (n > 0)) || (prefix == NULL)) {
+                abort();
+        }
+        for (size_t i = 0; i < n; i++) {
+                sorted[i] = ii->sizes[by_size[i]];
+        }
+        const size_t bound = l2_sorted(sorted, n, ii->cap, prefix);
+        free(sorted);
+        free(prefix);
+        return bound;
+}
+size_t lower_bound_l3(const struct int_inst *ii,
+                      const uint32_t *by_size) {
+        size_t n = ii->inst_sz;
+        uint32_t *sorted = malloc(n * sizeof(*sorted));
+        uint64_t *prefix = malloc((n + 1) * sizeof(*prefix));
+        size_t *next = malloc((n + 1) * sizeof(*next));
+        size_t *prev = malloc((n + 1) * sizeof(*prev));
+        if (((sorted == NULL) && (n > 0)) || (prefix == NULL)
+            || (next == NULL) || (prev == NULL)) {
+                abort();
+        }
+        for (size_t i = 0; i < n; i++) {
+                sorted[i] = ii->sizes[by_size[i]];
+        }
+        /* the bins reduction fixes plus L2 of the rest bound the whole;
+         * dropping the smallest item left may let reduction go further,
+         * and a bound on fewer items still holds for all of them */
+        size_t best = 0;
+        size_t num_fixed = 0;
+        while (true) {
+                size_t num_reduced;
+                do {
+                        num_reduced = reduce(sorted, &n, ii->cap, next, prev);
+                        num_fixed += num_reduced;
+                } while (num_reduced > 0);
+                const size_t bound = num_fixed
+                                     + l2_sorted(sorted, n, ii->cap, prefix);
+                if (bound > best) {
+                        best = bound;
+                }
+                if (n == 0) {
+                        break;
+                }
+                n--;
+        }
+        free(sorted);
+        free(prefix);
+        free(next);
+        free(prev);
+        return best;
+}
+size_t lower_bound_best(const struct int_inst *ii,
+                        const uint32_t *by_size) {
+        size_t best = lower_bound_l1(ii);
+        const size_t l2 = lower_bound_l2(ii, by_size);
+        const size_t l3 = lower_bound_l3(ii, by_size);
+        if (l2 > best) {
+                best = l2;
+        }
+        return (l3 > best) ? l3 : best;
+}
+void lower_bound_order(const double *prob_inst,
+                       size_t inst_sz,
+                       uint32_t *by_size) {
+        struct sized_index *items = malloc(inst_sz * sizeof(*items));
+        if ((items == NULL) && (inst_sz > 0)) {
+                abort();
+        }
+        for (size_t i = 0; i < inst_sz; i++) {
+                items[i] = (struct sized_index){.size = prob_inst[i],
+                                                .index = i};
+        }
+        qsort(items, inst_sz, sizeof(*items), order_cmp);
+        for (size_t i = 0; i < inst_sz; i++) {
+                by_size[i] = items[i].index;
+        }
+        free(items);
+}
+
+static size_t count_above(const uint32_t *sorted,
+                          size_t num,
+                          uint64_t val) {
+        size_t lo = 0;
+        size_t hi = num;
+        while (lo < hi) {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (sorted[mid] > val) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        return lo;
+}
+static size_t l2_sorted(const uint32_t *sorted,
+                        size_t num,
+                        uint64_t cap,
+                        uint64_t *prefix) {
+        /* prefix[i] is the sum of the i largest sizes */
+        prefix[0] = 0;
+        for (size_t i = 0; i < num; i++) {
+                prefix[i + 1] = prefix[i] + sorted[i];
+        }
+        /* items over half the capacity, pairwise unable to share */
+        const size_t num_big = count_above(sorted, num, cap / 2);
+        size_t best = 0;
+        /* k = 0 first, then every distinct size up to half the capacity */
+        size_t next = num_big;
+        uint64_t k = 0;
+        while (true) {
+                const size_t num_huge = count_above(sorted, num, cap - k);
+                const size_t num_small = (k == 0)
+                                         ? num
+                                         : count_above(sorted, num, k - 1);
+                const uint64_t room = (num_big - num_huge) * cap
+                                      - (prefix[num_big] - prefix[num_huge]);
+                const uint64_t small = prefix[num_small] - prefix[num_big];
+                size_t bound = num_big;
+                if (small > room) {
+                        bound += (small - room + cap - 1) / cap;
+                }
+                if (bound > best) {
+                        best = bound;
+                }
+                if ((next == num) || (sorted[next] == 0)) {
+                        break;
+                }
+                k = sorted[next];
+                next = count_above(sorted, num, k - 1);
+        }
+        return best;
+}
+static size_t reduce(uint32_t *sorted,
+                     size_t *num,
+                     uint64_t cap,
+                     size_t *next,
+                     size_t *prev) {
+        const size_t n = *num;
+        /* prev is shifted by one so that 0 can stand for none */
+        for (size_t i = 0; i <= n; i++) {
+                next[i] = i;
+                prev[i] = i;
+        }
+#define TAKE_OUT(I) \
+        do { \
+                next[I] = (I) + 1; \
+                prev[(I) + 1] = (I); \
+        } while (0)
+        size_t num_bins = 0;
+        for (size_t i = find_next(next, 0); i < n;
+             i = find_next(next, i + 1)) {
+                if (sorted[i] >= cap) {
+                        TAKE_OUT(i);
+                        num_bins++;
+                        continue;
+                }
+                const uint64_t space = cap - sorted[i];
+                /* the largest other item that fits with i */
+                size_t j = find_next(next, count_above(sorted, n, space));
+                if (j == i) {
+                        j = find_next(next, i + 1);
+                }
+                if (j == n) {
+                        /* i goes alone */
+                        TAKE_OUT(i);
+                        num_bins++;
+                        continue;
+                }
+                /* {i, j} is as good as any bin holding i if it fills the
+                 * bin, or if no two other items fit with i, as then any
+                 * one that fits is no bigger than j */
+                bool is_dominant = sorted[j] == space;
+                if (!is_dominant) {
+                        size_t a = find_prev(prev, n);
+                        if (a == i + 1) {
+                                a = find_prev(prev, i);
+                        }
+                        size_t b = (a > 0) ? find_prev(prev, a - 1) : 0;
+                        if (b == i + 1) {
+                                b = find_prev(prev, i);
+                        }
+                        is_dominant = (b == 0)
+                                      || ((uint64_t)sorted[a - 1]
+                                          + sorted[b - 1] > space);
+                }
+                if (is_dominant) {
+                        TAKE_OUT(i);
+                        TAKE_OUT(j);
+                        num_bins++;
+                }
+        }
+#undef TAKE_OUT
+        size_t left = 0;
+        for (size_t i = find_next(next, 0); i < n;
+             i = find_next(next, i + 1)) {
+                sorted[left++] = sorted[i];
+        }
+        *num = left;
+        return num_bins;
+}
+static size_t find_next(size_t *next,
+                        size_t pos) {
+        while (next[pos] != pos) {
+                next[pos] = next[next[pos]];
+                pos = next[pos];
+        }
+        return pos;
+}
+static size_t find_prev(size_t *prev,
+                        size_t pos) {
+        while (prev[pos] != pos) {
+                prev[pos] = prev[prev[pos]];
+                pos = prev[pos];
+        }
+        return pos;
+}
+static int order_cmp(const void *a,
+                     const void *b) {
+        const struct sized_index *ia = a;
+        const struct sized_index *ib = b;
+        if (ia->size != ib->size) {
+                return (ia->size > ib->size) ? -1 : 1;
+        }
+        return (ia->index > ib->index) - (ia->index < ib->index);
+}
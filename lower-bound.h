@@ -0,0 +1,40 @@
+#ifndef LOWER_BOUND_H
+#define LOWER_BOUND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "int-inst.h"
+
+/* Lower bounds on the number of bins, computed in the exact units of an
+ * int_inst. by_size lists the item indices by decreasing size; see
+ * lower_bound_order. */
+
+/* the size sum over the capacity, rounded up */
+size_t lower_bound_l1(const struct int_inst *ii);
+/* L1 of sizes with no exact integer form, allowing for the rounding of
+ * their sum */
+size_t lower_bound_l1_double(const double *prob_inst,
+                             size_t inst_sz,
+                             double bin_cap);
+/* Martello and Toth's L2: for every threshold k, the items too big to
+ * share a bin with an item of size k or more each need a bin, and the
+ * items of size k up to half the capacity must fit in what the big ones
+ * leave. O(n + d log n) for d distinct sizes. */
+size_t lower_bound_l2(const struct int_inst *ii,
+                      const uint32_t *by_size);
+/* Martello and Toth's L3: bins that a reduction proves some optimal
+ * packing has are taken out with their items, and L2 bounds the rest;
+ * then the smallest item left is dropped and the reduction tried again,
+ * until no items are left. The best of these holds. O(n^2) at worst. */
+size_t lower_bound_l3(const struct int_inst *ii,
+                      const uint32_t *by_size);
+/* the largest of L1, L2 and L3 */
+size_t lower_bound_best(const struct int_inst *ii,
+                        const uint32_t *by_size);
+/* fills by_size with the indices of prob_inst by decreasing size, earlier
+ * items first on ties */
+void lower_bound_order(const double *prob_inst,
+                       size_t inst_sz,
+                       uint32_t *by_size);
+
+#endif /* !LOWER_BOUND_H */
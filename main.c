@@ -1,15 +1,23 @@
 #include "bin-packing.h"
+#include "parallel-foreach.h"
+#include "ff-scan.h"
+#include "prob-set.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <float.h>
 #include <limits.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
 
 static bool USE_CASE_INJECTION = false;
 static enum init_type INIT = SUCCESSIVE_MUT;
 static bool USE_LOCAL_SEARCH = true;
 static enum search_type SEARCH = SWAP_RAND;
 static enum search_adaptation_type ADAPT = LAMARCKIAN;
+static ga_engine_func ENGINE = genetic_algorithm;
 static int MAX_GENERATIONS
         // = INT_MAX;
         = 1000;
@@ -17,7 +25,52 @@ static double MAX_TIME
         = DBL_MAX;
         // = 3;
 
-static const int MAX_THREADS = 4;
+static int MAX_THREADS = 4;
+static bool IS_MAX_THREADS_SET = false;
+/* Problems solved at once; 0 for one per online cpu. Each prints what it
+ * would alone, except under case injection: a problem then starts from the
+ * cases of whichever problems finished before it began, which depends on
+ * scheduling, so the output no longer matches a run with batch=1 and may
+ * differ between runs. */
+static size_t BATCH = 1;
+/* the one problem to solve, or SIZE_MAX for all of them */
+static size_t ONLY_PROBLEM = SIZE_MAX;
+static bool PRINT_STATS = false;
+/* end a run once it reaches the optimum the problem file gives */
+static bool USE_KNOWN_OPTIMUM = true;
+static struct ga_tuning TUNING;
+/* file of the case store that persists between runs, or NULL */
+static const char *CASES_PATH = NULL;
+static struct case_store CASES;
+
+/* optional trailing arguments of the form name=value */
+static int parse_option(const char *arg);
+static bool parse_size(const char *str,
+                       size_t *out);
+/* the first-fit scan kernel named by str, if the cpu has it */
+static bool parse_isa(const char *str,
+                      enum ff_isa *out);
+
+static void solve_problem(const struct problem *prob,
+                          int max_threads,
+                          FILE *out);
+/* Problems are handed to num_workers threads in input order, each run
+ * getting threads_per_run threads of its own; main prints each one's
+ * output as soon as those before it are out. */
+struct batch {
+        const struct prob_set *set;
+        /* what each run printed, held back until the problems before it
+         * are printed; NULL until solved */
+        char **outs;
+        size_t *out_szs;
+        int threads_per_run;
+        atomic_size_t next;
+        pthread_mutex_t lock;
+        pthread_cond_t has_solved;
+};
+static void *batch_worker(void *batch);
+static void solve_batch(const struct prob_set *set,
+                        size_t num_workers);
 
 #define _STR(TOK)       #TOK
 #define STR(TOK)        _STR(TOK)
@@ -35,14 +88,18 @@ static const int MAX_THREADS = 4;
         } while(0)
 
 int main(int argc, char **argv) {
-        if (argc != 7) {
+        if (argc < 7) {
                 fprintf(stderr, "bad number of args: %d\n", argc);
                 return -1;
         }
         CHECK(1, true, false, USE_CASE_INJECTION);
         CHECK(2, SUCCESSIVE_MUT, HILL_CLIMB, INIT);
         CHECK(3, true, false, USE_LOCAL_SEARCH);
-        CHECK(4, SWAP_RAND, SHUFFLE_GROUPS, SEARCH);
+        if (strcmp(argv[4], STR(DOMINANCE)) == 0) {
+                SEARCH = DOMINANCE;
+        } else {
+                CHECK(4, SWAP_RAND, SHUFFLE_GROUPS, SEARCH);
+        }
         CHECK(5, LAMARCKIAN, BALDWINIAN, ADAPT);
         if (argv[6][0] == '1') {
                 MAX_GENERATIONS = INT_MAX;
@@ -54,42 +111,272 @@ int main(int argc, char **argv) {
                 fprintf(stderr, "1 or 0 for argument 6\n");
                 return -1;
         }
-        size_t num_problems;
-        scanf(" %zu", &num_problems);
-        for (size_t i=0; i<num_problems; i++) {
-                printf("PROBLEM #%zu:\n", i);
-                /* skip problem identifier */
-                scanf(" %*s");
-                double bin_cap;
-                size_t inst_sz, optimal_num_bins;
-                scanf(" %lf %zu %zu",
-                      &bin_cap, &inst_sz, &optimal_num_bins);
-                double *prob_inst = malloc(inst_sz * sizeof(*prob_inst));
-                if (prob_inst == NULL) {
-                        abort();
+        ga_tuning_init(&TUNING);
+        for (int i = 7; i < argc; i++) {
+                if (parse_option(argv[i]) != 0) {
+                        return -1;
                 }
-                for (size_t i=0; i<inst_sz; i++) {
-                        scanf(" %lf", prob_inst+i);
+        }
+        if (CASES_PATH != NULL) {
+                if (case_store_open(&CASES, CASES_PATH) != 0) {
+                        fprintf(stderr, "cannot open case store %s\n",
+                                CASES_PATH);
+                        return -1;
                 }
+                TUNING.case_store = &CASES;
+        }
+        struct prob_set set;
+        const int read_ret = (ONLY_PROBLEM == SIZE_MAX)
+                             ? prob_set_read(&set, STDIN_FILENO)
+                             : prob_set_read_one(&set, STDIN_FILENO,
+                                                 ONLY_PROBLEM);
+        if ((read_ret != 0) && (ONLY_PROBLEM != SIZE_MAX)) {
+                fprintf(stderr, "malformed problem file or no problem %zu\n",
+                        ONLY_PROBLEM);
+                return -1;
+        } else if (read_ret != 0) {
+                fprintf(stderr, "malformed problem file\n");
+                return -1;
+        }
+        if (BATCH == 0) {
+                const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                BATCH = (num_cpus > 0) ? num_cpus : 1;
+        }
+        if ((BATCH > 1) && TUNING.island_procs) {
+                fprintf(stderr, "island_procs=1 needs batch=1\n");
+                return -1;
+        }
+        if (ONLY_PROBLEM != SIZE_MAX) {
+                printf("PROBLEM #%zu:\n", ONLY_PROBLEM);
+                solve_problem(&set.problems[0], MAX_THREADS, stdout);
+        } else if (BATCH == 1) {
+                for (size_t i=0; i<set.num_problems; i++) {
+                        printf("PROBLEM #%zu:\n", i);
+                        solve_problem(&set.problems[i], MAX_THREADS, stdout);
+                }
+        } else {
+                solve_batch(&set, BATCH);
+        }
+        prob_set_destroy(set);
+        if (CASES_PATH != NULL) {
+                case_store_close(&CASES);
+        }
+        if (PRINT_STATS) {
+                struct para_foreach_stats stats;
+                parallel_foreach_stats(&stats);
+                fprintf(stderr, "dispatches: %zu\tbusy: %lf\ttail idle: %lf\n",
+                        stats.dispatches, stats.busy, stats.tail_idle);
+        }
+        return 0;
+}
 
-                struct solution sol;
-                sol = genetic_algorithm(prob_inst,
-                                        inst_sz,
-                                        bin_cap,
-                                        USE_CASE_INJECTION,
-                                        INIT,
-                                        USE_LOCAL_SEARCH,
-                                        SEARCH,
-                                        ADAPT,
-                                        MAX_THREADS,
-                                        MAX_GENERATIONS,
-                                        MAX_TIME,
-                                        stdout);
-                solution_destroy(sol);
-                free(prob_inst);
+static int parse_option(const char *arg) {
+        const char *val = strchr(arg, '=');
+        if (val == NULL) {
+                fprintf(stderr, "expected name=value, got %s\n", arg);
+                return -1;
+        }
+        const size_t name_len = val - arg;
+        val++;
+        size_t num;
+        enum ff_isa isa;
+#define IS_OPT(NAME) \
+        ((name_len == strlen(NAME)) && (strncmp(arg, NAME, name_len) == 0))
+        if (IS_OPT("threads") && parse_size(val, &num) && (num > 0)
+            && (num <= INT_MAX)) {
+                MAX_THREADS = num;
+                IS_MAX_THREADS_SET = true;
+        } else if (IS_OPT("problem") && parse_size(val, &num)
+                   && (num < SIZE_MAX)) {
+                ONLY_PROBLEM = num;
+        } else if (IS_OPT("batch") && parse_size(val, &num)
+                   && (num <= INT_MAX)) {
+                BATCH = num;
+        } else if (IS_OPT("gens") && parse_size(val, &num) && (num > 0)
+                   && (num <= INT_MAX)) {
+                MAX_GENERATIONS = num;
+        } else if (IS_OPT("engine") && (strcmp(val, "perm") == 0)) {
+                ENGINE = genetic_algorithm;
+        } else if (IS_OPT("engine") && (strcmp(val, "group") == 0)) {
+                ENGINE = grouping_genetic_algorithm;
+        } else if (IS_OPT("sched") && (strcmp(val, "static") == 0)) {
+                TUNING.search_sched = PARA_STATIC;
+        } else if (IS_OPT("sched") && (strcmp(val, "dynamic") == 0)) {
+                TUNING.search_sched = PARA_DYNAMIC;
+        } else if (IS_OPT("grain") && parse_size(val, &num) && (num > 0)) {
+                TUNING.search_grain = num;
+        } else if (IS_OPT("decoder") && (strcmp(val, "linear") == 0)) {
+                TUNING.decoder = FIRST_FIT_LINEAR;
+        } else if (IS_OPT("decoder") && (strcmp(val, "tree") == 0)) {
+                TUNING.decoder = FIRST_FIT_TREE;
+        } else if (IS_OPT("isa") && parse_isa(val, &isa)) {
+                ff_scan_select(isa);
+        } else if (IS_OPT("sizes") && (strcmp(val, "auto") == 0)) {
+                TUNING.int_sizes = true;
+        } else if (IS_OPT("sizes") && (strcmp(val, "double") == 0)) {
+                TUNING.int_sizes = false;
+        } else if (IS_OPT("cache") && parse_size(val, &num) && (num <= 30)) {
+                TUNING.cache_bits = num;
+        } else if (IS_OPT("elites") && parse_size(val, &num)) {
+                TUNING.elites = num;
+        } else if (IS_OPT("islands") && parse_size(val, &num) && (num > 0)
+                   && (num <= 1024)) {
+                TUNING.islands = num;
+        } else if (IS_OPT("migrate") && parse_size(val, &num)
+                   && (num <= INT_MAX)) {
+                TUNING.migration_interval = num;
+        } else if (IS_OPT("migrants") && parse_size(val, &num)) {
+                TUNING.migrants = num;
+        } else if (IS_OPT("island_procs") && (strcmp(val, "1") == 0)) {
+                TUNING.island_procs = true;
+        } else if (IS_OPT("island_procs") && (strcmp(val, "0") == 0)) {
+                TUNING.island_procs = false;
+        } else if (IS_OPT("cases") && (*val != '\0')) {
+                CASES_PATH = val;
+        } else if (IS_OPT("case_k") && parse_size(val, &num)) {
+                TUNING.case_k = num;
+        } else if (IS_OPT("optimum") && (strcmp(val, "1") == 0)) {
+                USE_KNOWN_OPTIMUM = true;
+        } else if (IS_OPT("optimum") && (strcmp(val, "0") == 0)) {
+                USE_KNOWN_OPTIMUM = false;
+        } else if (IS_OPT("seed") && parse_size(val, &num)) {
+                TUNING.seed = num;
+        } else if (IS_OPT("stats") && (strcmp(val, "1") == 0)) {
+                PRINT_STATS = true;
+        } else if (IS_OPT("stats") && (strcmp(val, "0") == 0)) {
+                PRINT_STATS = false;
+        } else {
+                fprintf(stderr, "bad option: %s\n", arg);
+                return -1;
         }
+#undef IS_OPT
         return 0;
 }
+static bool parse_size(const char *str,
+                       size_t *out) {
+        char *end;
+        if ((*str < '0') || (*str > '9')) {
+                return false;
+        }
+        unsigned long long tmp = strtoull(str, &end, 10);
+        if ((*end != '\0') || (tmp > SIZE_MAX)) {
+                return false;
+        }
+        *out = tmp;
+        return true;
+}
+static bool parse_isa(const char *str,
+                      enum ff_isa *out) {
+        for (int isa = 0; isa < FF_NUM_ISAS; isa++) {
+                if ((strcmp(str, ff_isa_name(isa)) == 0)
+                    && ff_isa_supported(isa)) {
+                        *out = isa;
+                        return true;
+                }
+        }
+        return false;
+}
+
+static void solve_problem(const struct problem *prob,
+                          int max_threads,
+                          FILE *out) {
+        struct solution sol;
+        sol = ENGINE(prob->prob_inst,
+                     prob->inst_sz,
+                     prob->bin_cap,
+                     prob->lower_bound,
+                     (USE_KNOWN_OPTIMUM) ? prob->optimal_num_bins : 0,
+                     USE_CASE_INJECTION,
+                     INIT,
+                     USE_LOCAL_SEARCH,
+                     SEARCH,
+                     ADAPT,
+                     max_threads,
+                     MAX_GENERATIONS,
+                     MAX_TIME,
+                     out,
+                     &TUNING,
+                     NULL);
+        solution_destroy(sol);
+}
+static void *batch_worker(void *batch) {
+        struct batch *b = batch;
+        size_t i;
+        while ((i = atomic_fetch_add(&b->next, 1)) < b->set->num_problems) {
+                const struct problem *prob = &b->set->problems[i];
+                char *out_buf;
+                size_t out_sz;
+                FILE *out = open_memstream(&out_buf, &out_sz);
+                if (out == NULL) {
+                        abort();
+                }
+                solve_problem(prob, b->threads_per_run, out);
+                fclose(out);
+
+                pthread_mutex_lock(&b->lock);
+                b->outs[i] = out_buf;
+                b->out_szs[i] = out_sz;
+                pthread_cond_broadcast(&b->has_solved);
+                pthread_mutex_unlock(&b->lock);
+        }
+        return NULL;
+}
+static void solve_batch(const struct prob_set *set,
+                        size_t num_workers) {
+        const size_t num_problems = set->num_problems;
+        if (num_workers > num_problems) {
+                num_workers = (num_problems > 0) ? num_problems : 1;
+        }
+        /* cores are split evenly unless threads= fixed the share */
+        int threads_per_run = MAX_THREADS;
+        if (!IS_MAX_THREADS_SET) {
+                const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                threads_per_run = (num_cpus > 0) ? num_cpus / num_workers
+                                                 : 1;
+                if (threads_per_run < 1) {
+                        threads_per_run = 1;
+                }
+        }
+        struct batch b = {.set = set,
+                          .outs = calloc(num_problems, sizeof(*b.outs)),
+                          .out_szs = calloc(num_problems, sizeof(*b.out_szs)),
+                          .threads_per_run = threads_per_run};
+        if (((b.outs == NULL) || (b.out_szs == NULL)) && (num_problems > 0)) {
+                abort();
+        }
+        atomic_init(&b.next, 0);
+        pthread_mutex_init(&b.lock, NULL);
+        pthread_cond_init(&b.has_solved, NULL);
+        pthread_t *workers = malloc(num_workers * sizeof(*workers));
+        if (workers == NULL) {
+                abort();
+        }
+        for (size_t i = 0; i < num_workers; i++) {
+                if (pthread_create(&workers[i], NULL, batch_worker, &b)
+                    != 0) {
+                        abort();
+                }
+        }
+        for (size_t i = 0; i < num_problems; i++) {
+                pthread_mutex_lock(&b.lock);
+                while (b.outs[i] == NULL) {
+                        pthread_cond_wait(&b.has_solved, &b.lock);
+                }
+                pthread_mutex_unlock(&b.lock);
+                printf("PROBLEM #%zu:\n", i);
+                fwrite(b.outs[i], 1, b.out_szs[i], stdout);
+                fflush(stdout);
+                free(b.outs[i]);
+        }
+        for (size_t i = 0; i < num_workers; i++) {
+                pthread_join(workers[i], NULL);
+        }
+        free(workers);
+        free(b.outs);
+        free(b.out_szs);
+        pthread_mutex_destroy(&b.lock);
+        pthread_cond_destroy(&b.has_solved);
+}
 
 static bool is_char_in_str(char ch, const char *str) {
         while (*str != '\0') {
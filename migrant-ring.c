@@ -0,0 +1,65 @@
+#include "migrant-ring.h"
+#include <assert.h>
+#include <string.h>
+
+/* a record is the fitness followed by the permutation */
+static size_t record_size(size_t perm_sz);
+static unsigned char *ring_record(struct migrant_ring *ring,
+                                  size_t pos);
+
+size_t migrant_ring_size(size_t cap,
+                         size_t perm_sz) {
+        return sizeof(struct migrant_ring) + cap * record_size(perm_sz);
+}
+void migrant_ring_init(struct migrant_ring *ring,
+                       size_t cap,
+                       size_t perm_sz) {
+        assert((cap > 0) && ((cap & (cap - 1)) == 0));
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        ring->cap = cap;
+        ring->perm_sz = perm_sz;
+}
+bool migrant_ring_push(struct migrant_ring *ring,
+                       const size_t *perm,
+                       double fitness) {
+        const size_t tail = atomic_load_explicit(&ring->tail,
+                                                 memory_order_relaxed);
+        const size_t head = atomic_load_explicit(&ring->head,
+                                                 memory_order_acquire);
+        if (tail - head == ring->cap) {
+                return false;
+        }
+        unsigned char *rec = ring_record(ring, tail);
+        memcpy(rec, &fitness, sizeof(fitness));
+        memcpy(rec + sizeof(fitness), perm, ring->perm_sz * sizeof(*perm));
+        /* publishes the record to the consumer */
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+        return true;
+}
+bool migrant_ring_pop(struct migrant_ring *ring,
+                      size_t *perm,
+                      double *fitness) {
+        const size_t head = atomic_load_explicit(&ring->head,
+                                                 memory_order_relaxed);
+        const size_t tail = atomic_load_explicit(&ring->tail,
+                                                 memory_order_acquire);
+        if (head == tail) {
+                return false;
+        }
+        const unsigned char *rec = ring_record(ring, head);
+        memcpy(fitness, rec, sizeof(*fitness));
+        memcpy(perm, rec + sizeof(*fitness), ring->perm_sz * sizeof(*perm));
+        /* hands the slot back to the producer */
+        atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+        return true;
+}
+
+static size_t record_size(size_t perm_sz) {
+        return sizeof(double) + perm_sz * sizeof(size_t);
+}
+static unsigned char *ring_record(struct migrant_ring *ring,
+                                  size_t pos) {
+        return ring->records
+               + (pos & (ring->cap - 1)) * record_size(ring->perm_sz);
+}
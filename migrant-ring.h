@@ -0,0 +1,39 @@
+#ifndef MIGRANT_RING_H
+#define MIGRANT_RING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Bounded single-producer single-consumer queue of migrants, each a
+ * permutation of perm_sz items with its fitness. The ring is one block
+ * with no pointers in it, so it can be placed in memory shared between
+ * processes as well as between threads; head and tail are lock-free
+ * counters on separate cache lines, each written by one side only. */
+struct migrant_ring {
+        /* next record to pop; written by the consumer */
+        _Alignas(64) atomic_size_t head;
+        /* next record to push; written by the producer */
+        _Alignas(64) atomic_size_t tail;
+        _Alignas(64) size_t cap;
+        size_t perm_sz;
+        /* cap records, see migrant_ring_size */
+        _Alignas(8) unsigned char records[];
+};
+/* bytes needed by a ring of cap records; cap must be a power of two */
+size_t migrant_ring_size(size_t cap,
+                         size_t perm_sz);
+/* sets up a ring in migrant_ring_size(cap, perm_sz) bytes at ring */
+void migrant_ring_init(struct migrant_ring *ring,
+                       size_t cap,
+                       size_t perm_sz);
+/* false, dropping the migrant, when the ring is full */
+bool migrant_ring_push(struct migrant_ring *ring,
+                       const size_t *perm,
+                       double fitness);
+/* false when the ring is empty */
+bool migrant_ring_pop(struct migrant_ring *ring,
+                      size_t *perm,
+                      double *fitness);
+
+#endif /* !MIGRANT_RING_H */
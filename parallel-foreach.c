@@ -2,21 +2,93 @@
 #include <pthread.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
 
-struct common_args {
+/* A single dispatch of parallel_foreach. Up to num_slots threads take
+ * part; a slot is claimed atomically by whichever thread gets to it first,
+ * so the calling thread never waits on a worker that has not woken up yet.
+ * With PARA_STATIC slot k handles the stride k, k + num_slots, ...; with
+ * PARA_DYNAMIC every participant pulls grain-sized chunks from next_index
+ * until the array runs out. A reduction gives slot k the accumulator at
+ * accs + k * acc_stride. */
+struct job {
         void *array;
         size_t count;
         size_t sz;
         void *context;
         para_foreach_func func;
-        int num_threads;
-        volatile int term_cond;
+        /* NULL unless reducing */
+        const struct para_reducer *reducer;
+        char *accs;
+        size_t acc_stride;
+        enum para_schedule sched;
+        size_t grain;
+        size_t num_slots;
+        atomic_size_t next_slot;
+        atomic_size_t next_index;
+        atomic_int term_cond;
+        /* the remaining fields are protected by pool.lock */
+        /* workers currently inside this job */
+        int active;
+        /* cpu time spent by each participant, for the idle statistics */
+        double busy_max;
+        double busy_sum;
+        int num_busy;
+        pthread_cond_t done;
+        struct job *next;
 };
-struct iterate_args {
-        struct common_args *common;
-        size_t index;
+
+/* Process-wide pool; workers park on has_work between dispatches. Several
+ * threads may dispatch at once, so pending jobs form a list. */
+static struct {
+        pthread_mutex_t lock;
+        pthread_cond_t has_work;
+        struct job *jobs;
+        int num_workers;
+        bool is_shutdown;
+        pthread_t *thrd_ids;
+} pool = {.lock = PTHREAD_MUTEX_INITIALIZER,
+          .has_work = PTHREAD_COND_INITIALIZER,
+          .jobs = NULL,
+          .num_workers = 0,
+          .is_shutdown = false,
+          .thrd_ids = NULL};
+
+static struct para_foreach_stats stats = {0};
+
+#define CACHE_LINE      64
+
+/* per-thread accumulator storage of parallel_reduce, only ever grown */
+struct reduce_buf {
+        void *accs;
+        size_t cap;
 };
-static void *pthread_iterate(void *args);
+static pthread_key_t reduce_buf_key;
+static pthread_once_t reduce_buf_once = PTHREAD_ONCE_INIT;
+
+static int job_dispatch(struct job *job);
+static void *reduce_buf_get(size_t size);
+static void reduce_buf_key_init(void);
+static void reduce_buf_destroy(void *buf);
+static int pool_reserve(int num_workers);
+static void *pool_worker(void *unused);
+static struct job *pool_claimable(void);
+/* returns whether a slot was claimed */
+static bool job_run(struct job *job);
+static void job_iterate(struct job *job,
+                        size_t slot);
+static void job_chunks(struct job *job,
+                       size_t slot);
+/* runs the callback on element i for slot */
+static int job_apply(struct job *job,
+                     size_t i,
+                     size_t slot);
+static void job_account(struct job *job,
+                        double busy);
+static double thread_time(void);
 
 int parallel_foreach(int num_threads,
                      void *array,
@@ -24,92 +96,372 @@ int parallel_foreach(int num_threads,
                      size_t sz,
                      void *context,
                      para_foreach_func func) {
-        int return_code = 0;
-        struct common_args common;
-        struct iterate_args *args = NULL;
-        pthread_t *thrd_ids = NULL;
+        return parallel_foreach_sched(num_threads, array, count, sz,
+                                      context, func, PARA_STATIC, 1);
+}
 
+int parallel_foreach_sched(int num_threads,
+                           void *array,
+                           size_t count,
+                           size_t sz,
+                           void *context,
+                           para_foreach_func func,
+                           enum para_schedule sched,
+                           size_t grain) {
         if ((num_threads < 1)
             || (array == NULL)
             || (count < 1)
             || (sz < 1)
-            || (func == NULL)) {
-                return_code = ERR_BAD_ARGS;
-                goto exit;
+            || (func == NULL)
+            || ((sched != PARA_STATIC) && (sched != PARA_DYNAMIC))
+            || (grain < 1)) {
+                return ERR_BAD_ARGS;
         }
 
         if (count < num_threads) {
                 num_threads = count;
         }
 
-        common = (struct common_args) {.array = array,
-                                       .count = count,
-                                       .sz = sz,
-                                       .context = context,
-                                       .func = func,
-                                       .num_threads = num_threads,
-                                       .term_cond = 0};
-        args = malloc(num_threads * sizeof(*args));
-        if (args == NULL) {
-                return_code = ERR_MALLOC_FAIL;
-                goto exit;
+        struct job job = {.array = array,
+                          .count = count,
+                          .sz = sz,
+                          .context = context,
+                          .func = func,
+                          .reducer = NULL,
+                          .accs = NULL,
+                          .acc_stride = 0,
+                          .sched = sched,
+                          .grain = grain,
+                          .num_slots = num_threads};
+        return job_dispatch(&job);
+}
+
+int parallel_reduce(int num_threads,
+                    void *array,
+                    size_t count,
+                    size_t sz,
+                    void *context,
+                    const struct para_reducer *reducer,
+                    void *result,
+                    enum para_schedule sched,
+                    size_t grain) {
+        if ((num_threads < 1)
+            || (array == NULL)
+            || (count < 1)
+            || (sz < 1)
+            || (reducer == NULL)
+            || (reducer->acc_sz < 1)
+            || (reducer->init == NULL)
+            || (reducer->combine == NULL)
+            || (reducer->func == NULL)
+            || (result == NULL)
+            || ((sched != PARA_STATIC) && (sched != PARA_DYNAMIC))
+            || (grain < 1)) {
+                return ERR_BAD_ARGS;
         }
-        for (int i = 0; i < num_threads; i++) {
-                args[i] = (struct iterate_args){.common = &common,
-                                                .index = i};
+
+        if (count < (size_t)num_threads) {
+                num_threads = count;
         }
 
-        thrd_ids = malloc((num_threads - 1) * sizeof(*thrd_ids));
-        if (thrd_ids == NULL) {
-                return_code = ERR_MALLOC_FAIL;
-                goto exit;
+        const size_t acc_stride = ((reducer->acc_sz + CACHE_LINE - 1)
+                                   / CACHE_LINE) * CACHE_LINE;
+        char *accs = reduce_buf_get(num_threads * acc_stride);
+        if (accs == NULL) {
+                return ERR_MALLOC_FAIL;
+        }
+        for (int k = 0; k < num_threads; k++) {
+                reducer->init(accs + (k * acc_stride), context);
         }
+        struct job job = {.array = array,
+                          .count = count,
+                          .sz = sz,
+                          .context = context,
+                          .func = NULL,
+                          .reducer = reducer,
+                          .accs = accs,
+                          .acc_stride = acc_stride,
+                          .sched = sched,
+                          .grain = grain,
+                          .num_slots = num_threads};
+        const int term_cond = job_dispatch(&job);
 
-        for (int i = 0; i < num_threads - 1; i++) {
-                int err = pthread_create(thrd_ids + i, NULL,
-                                         pthread_iterate, args + i);
-                if (err != 0) {
-                        return_code = ERR_PTHREAD_FAIL;
-                        goto exit;
+        reducer->init(result, context);
+        for (int k = 0; k < num_threads; k++) {
+                reducer->combine(result, accs + (k * acc_stride), context);
+        }
+        return term_cond;
+}
+
+void parallel_foreach_stats(struct para_foreach_stats *out) {
+        pthread_mutex_lock(&pool.lock);
+        *out = stats;
+        pthread_mutex_unlock(&pool.lock);
+}
+void parallel_foreach_stats_reset(void) {
+        pthread_mutex_lock(&pool.lock);
+        memset(&stats, 0, sizeof(stats));
+        pthread_mutex_unlock(&pool.lock);
+}
+
+void parallel_foreach_shutdown(void) {
+        pthread_mutex_lock(&pool.lock);
+        pool.is_shutdown = true;
+        pthread_cond_broadcast(&pool.has_work);
+        pthread_mutex_unlock(&pool.lock);
+
+        for (int i = 0; i < pool.num_workers; i++) {
+                pthread_join(pool.thrd_ids[i], NULL);
+        }
+
+        pthread_mutex_lock(&pool.lock);
+        free(pool.thrd_ids);
+        pool.thrd_ids = NULL;
+        pool.num_workers = 0;
+        pool.is_shutdown = false;
+        pthread_mutex_unlock(&pool.lock);
+}
+
+/* runs a job whose public fields are filled in */
+static int job_dispatch(struct job *job) {
+        job->active = 0;
+        job->busy_max = 0;
+        job->busy_sum = 0;
+        job->num_busy = 0;
+        job->next = NULL;
+        atomic_init(&job->next_slot, 0);
+        atomic_init(&job->next_index, 0);
+        atomic_init(&job->term_cond, 0);
+
+        /* nothing to hand off */
+        if (job->num_slots == 1) {
+                job_iterate(job, 0);
+                return atomic_load(&job->term_cond);
+        }
+
+        int err = pool_reserve(job->num_slots - 1);
+        if (err != 0) {
+                return err;
+        }
+        if (pthread_cond_init(&job->done, NULL) != 0) {
+                return ERR_PTHREAD_FAIL;
+        }
+
+        pthread_mutex_lock(&pool.lock);
+        job->next = pool.jobs;
+        pool.jobs = job;
+        pthread_cond_broadcast(&pool.has_work);
+        pthread_mutex_unlock(&pool.lock);
+
+        double busy = thread_time();
+        bool did_work = job_run(job);
+        busy = thread_time() - busy;
+
+        /* unlink so no new worker joins, then wait out the ones inside */
+        pthread_mutex_lock(&pool.lock);
+        struct job **link = &pool.jobs;
+        while (*link != job) {
+                link = &(*link)->next;
+        }
+        *link = job->next;
+        while (job->active > 0) {
+                pthread_cond_wait(&job->done, &pool.lock);
+        }
+        if (did_work) {
+                job_account(job, busy);
+        }
+        stats.dispatches++;
+        stats.busy += job->busy_sum;
+        stats.tail_idle += (job->busy_max * job->num_busy) - job->busy_sum;
+        pthread_mutex_unlock(&pool.lock);
+
+        pthread_cond_destroy(&job->done);
+        return atomic_load(&job->term_cond);
+}
+
+/* storage for size bytes of accumulators, cache-line aligned */
+static void *reduce_buf_get(size_t size) {
+        pthread_once(&reduce_buf_once, reduce_buf_key_init);
+        struct reduce_buf *buf = pthread_getspecific(reduce_buf_key);
+        if (buf == NULL) {
+                buf = malloc(sizeof(*buf));
+                if (buf == NULL) {
+                        return NULL;
+                }
+                *buf = (struct reduce_buf){.accs = NULL,
+                                           .cap = 0};
+                pthread_setspecific(reduce_buf_key, buf);
+        }
+        if (buf->cap < size) {
+                void *accs = aligned_alloc(CACHE_LINE, size);
+                if (accs == NULL) {
+                        return NULL;
                 }
+                free(buf->accs);
+                buf->accs = accs;
+                buf->cap = size;
         }
-        pthread_iterate(args + num_threads - 1);
+        return buf->accs;
+}
+static void reduce_buf_key_init(void) {
+        if (pthread_key_create(&reduce_buf_key, reduce_buf_destroy) != 0) {
+                abort();
+        }
+}
+static void reduce_buf_destroy(void *buf) {
+        struct reduce_buf *bufv = buf;
+        free(bufv->accs);
+        free(buf);
+}
 
-        for (int i = 0; i < num_threads - 1; i++) {
-                int err = pthread_join(thrd_ids[i], NULL);
+/* grows the pool to at least num_workers threads; the pool never shrinks */
+static int pool_reserve(int num_workers) {
+        int return_code = 0;
+        pthread_mutex_lock(&pool.lock);
+        if (num_workers <= pool.num_workers) {
+                goto exit;
+        }
+        pthread_t *tmp = realloc(pool.thrd_ids,
+                                 num_workers * sizeof(*tmp));
+        if (tmp == NULL) {
+                return_code = ERR_MALLOC_FAIL;
+                goto exit;
+        }
+        pool.thrd_ids = tmp;
+        while (pool.num_workers < num_workers) {
+                int err = pthread_create(pool.thrd_ids + pool.num_workers,
+                                         NULL, pool_worker, NULL);
                 if (err != 0) {
                         return_code = ERR_PTHREAD_FAIL;
                         goto exit;
                 }
+                pool.num_workers++;
         }
 
-        return_code = common.term_cond;
-
 exit:
-        if (args != NULL) {
-                free(args);
+        pthread_mutex_unlock(&pool.lock);
+        return return_code;
+}
+
+static void *pool_worker(void *unused) {
+        (void)unused;
+        pthread_mutex_lock(&pool.lock);
+        while (true) {
+                struct job *job;
+                while (((job = pool_claimable()) == NULL)
+                       && !pool.is_shutdown) {
+                        pthread_cond_wait(&pool.has_work, &pool.lock);
+                }
+                if (job == NULL) {
+                        break;
+                }
+                job->active++;
+                pthread_mutex_unlock(&pool.lock);
+
+                double busy = thread_time();
+                bool did_work = job_run(job);
+                busy = thread_time() - busy;
+
+                pthread_mutex_lock(&pool.lock);
+                if (did_work) {
+                        job_account(job, busy);
+                }
+                job->active--;
+                if (job->active == 0) {
+                        pthread_cond_signal(&job->done);
+                }
         }
-        if (args != NULL) {
-                free(thrd_ids);
+        pthread_mutex_unlock(&pool.lock);
+        return NULL;
+}
+
+/* must hold pool.lock; returns a job that still has unclaimed slots */
+static struct job *pool_claimable(void) {
+        for (struct job *job = pool.jobs; job != NULL; job = job->next) {
+                if (atomic_load(&job->next_slot) < job->num_slots) {
+                        return job;
+                }
         }
-        return return_code;
+        return NULL;
 }
 
-static void *pthread_iterate(void *args) {
-        struct iterate_args *argsv = args;
-        for (size_t i = argsv->index;
-             i < argsv->common->count;
-             i += argsv->common->num_threads) {
-                if (argsv->common->term_cond < 0) {
-                        return NULL;
+static bool job_run(struct job *job) {
+        bool did_work = false;
+        size_t slot;
+        while ((slot = atomic_fetch_add(&job->next_slot, 1))
+               < job->num_slots) {
+                did_work = true;
+                if (job->sched == PARA_DYNAMIC) {
+                        job_chunks(job, slot);
+                        break;
                 }
-                int err = argsv->common->func(argsv->common->array
-                                              + (i * argsv->common->sz),
-                                              argsv->common->context);
+                job_iterate(job, slot);
+        }
+        return did_work;
+}
+
+static void job_iterate(struct job *job,
+                        size_t slot) {
+        for (size_t i = slot; i < job->count; i += job->num_slots) {
+                if (atomic_load_explicit(&job->term_cond,
+                                         memory_order_relaxed) < 0) {
+                        return;
+                }
+                int err = job_apply(job, i, slot);
                 if (err < 0) {
-                        argsv->common->term_cond = err;
-                        return NULL;
+                        atomic_store(&job->term_cond, err);
+                        return;
                 }
         }
-        return NULL;
+}
+
+static void job_chunks(struct job *job,
+                       size_t slot) {
+        size_t start;
+        while ((start = atomic_fetch_add(&job->next_index, job->grain))
+               < job->count) {
+                size_t end = start + job->grain;
+                if (end > job->count) {
+                        end = job->count;
+                }
+                for (size_t i = start; i < end; i++) {
+                        if (atomic_load_explicit(&job->term_cond,
+                                                 memory_order_relaxed) < 0) {
+                                return;
+                        }
+                        int err = job_apply(job, i, slot);
+                        if (err < 0) {
+                                atomic_store(&job->term_cond, err);
+                                return;
+                        }
+                }
+        }
+}
+
+static int job_apply(struct job *job,
+                     size_t i,
+                     size_t slot) {
+        void *elem = (char *)job->array + (i * job->sz);
+        if (job->reducer == NULL) {
+                return job->func(elem, job->context);
+        }
+        return job->reducer->func(elem, job->accs + (slot * job->acc_stride),
+                                  job->context);
+}
+/* must hold pool.lock */
+static void job_account(struct job *job,
+                        double busy) {
+        if (busy > job->busy_max) {
+                job->busy_max = busy;
+        }
+        job->busy_sum += busy;
+        job->num_busy++;
+}
+
+/* cpu time of the calling thread, so the idle statistics stay meaningful
+ * when there are fewer cores than threads */
+static double thread_time(void) {
+        struct timespec t;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+        return t.tv_sec + (t.tv_nsec / 1000000000.0);
 }
@@ -8,6 +8,14 @@
 typedef int (*para_foreach_func)(void *elem,
                                  void *context);
 
+/** PARA_STATIC gives thread k the elements k, k + num_threads, ...;
+  * PARA_DYNAMIC hands out chunks of grain consecutive elements to whichever
+  * thread is free, which suits callbacks of uneven cost */
+enum para_schedule {
+        PARA_STATIC,
+        PARA_DYNAMIC
+};
+
 enum parallel_foreach_errors {
         ERR_BAD_ARGS = 1,
         ERR_MALLOC_FAIL,
@@ -15,12 +23,72 @@ enum parallel_foreach_errors {
 };
 /** Returns 0 if all threads ran to completion, else returns the negative
  * non-zero value that terminated the threads or an error code for internal
- * errors */
+ * errors. Work is handed to a process-wide pool of num_threads - 1 parked
+ * workers (created on first use) plus the calling thread; it is safe to
+ * call from several threads at once */
 int parallel_foreach(int num_threads,
                      void *array,
                      size_t count,
                      size_t sz,
                      void *context,
                      para_foreach_func func);
+/** parallel_foreach with an explicit schedule; grain is ignored by
+ * PARA_STATIC but must still be at least 1 */
+int parallel_foreach_sched(int num_threads,
+                           void *array,
+                           size_t count,
+                           size_t sz,
+                           void *context,
+                           para_foreach_func func,
+                           enum para_schedule sched,
+                           size_t grain);
+
+/** Folds elem into acc, the accumulator private to the calling slot; same
+ * return convention as para_foreach_func */
+typedef int (*para_reduce_func)(void *elem,
+                                void *acc,
+                                void *context);
+/** Accumulator of parallel_reduce: acc_sz bytes that init empties and
+ * combine merges src into dest */
+struct para_reducer {
+        size_t acc_sz;
+        void (*init)(void *acc,
+                     void *context);
+        void (*combine)(void *dest,
+                        const void *src,
+                        void *context);
+        para_reduce_func func;
+};
+/** parallel_foreach_sched where each slot folds its elements into its own
+ * accumulator, cache-line apart, so no state is shared while running.
+ * Afterwards result is initialized and the accumulators are combined into
+ * it in slot order on the calling thread. Under PARA_STATIC which
+ * elements meet in an accumulator depends only on num_threads and count,
+ * so even a floating-point sum comes out the same on every run. Must not
+ * be called from inside a reducer on the same thread */
+int parallel_reduce(int num_threads,
+                    void *array,
+                    size_t count,
+                    size_t sz,
+                    void *context,
+                    const struct para_reducer *reducer,
+                    void *result,
+                    enum para_schedule sched,
+                    size_t grain);
+
+/** Totals over every multi-threaded dispatch since the last reset, in
+ * seconds of thread cpu time. tail_idle is, per dispatch, the time each
+ * participating thread would have waited on the slowest one */
+struct para_foreach_stats {
+        size_t dispatches;
+        double busy;
+        double tail_idle;
+};
+void parallel_foreach_stats(struct para_foreach_stats *out);
+void parallel_foreach_stats_reset(void);
+
+/** Joins and frees the worker pool; the next parallel_foreach call will
+ * create a fresh one. Must not race with any parallel_foreach call */
+void parallel_foreach_shutdown(void);
 
 #endif /* !PARALLEL_FOREACH_H */
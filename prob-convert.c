@@ -0,0 +1,43 @@
+#include "prob-set.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Converts the problem file on stdin, text or binary, into the binary
+ * format of prob-set.h on stdout and lists what it wrote on stderr. The
+ * optional argument is the width of the stored sizes: auto (the default)
+ * for the narrowest exact one, or 1, 2, 4 or 8. */
+int main(int argc, char **argv) {
+        int width = 0;
+        if (argc > 1) {
+                if (strcmp(argv[1], "auto") == 0) {
+                        width = 0;
+                } else if ((strcmp(argv[1], "1") == 0)
+                           || (strcmp(argv[1], "2") == 0)
+                           || (strcmp(argv[1], "4") == 0)
+                           || (strcmp(argv[1], "8") == 0)) {
+                        width = atoi(argv[1]);
+                } else {
+                        fprintf(stderr, "bad width: %s\n", argv[1]);
+                        return -1;
+                }
+        }
+        if (isatty(STDOUT_FILENO)) {
+                fprintf(stderr, "refusing to write binary to a terminal\n");
+                return -1;
+        }
+        struct prob_set set;
+        if (prob_set_read(&set, STDIN_FILENO) != 0) {
+                fprintf(stderr, "malformed problem file\n");
+                return -1;
+        }
+        if (prob_set_write_bin(&set, stdout, width) != 0) {
+                fprintf(stderr, "write failed\n");
+                prob_set_destroy(set);
+                return -1;
+        }
+        fprintf(stderr, "%zu problems\n", set.num_problems);
+        prob_set_destroy(set);
+        return (fflush(stdout) == 0) ? 0 : -1;
+}
@@ -0,0 +1,235 @@
+#include "prob-set.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* integral sizes, tenths, and thirds that have no exact integer form */
+static const char TEXT[] =
+        "3\n"
+        " int_00\n"
+        " 150 6 2\n"
+        "100\n50\n70\n30\n40\n10\n"
+        " tenth_01\n"
+        " 1 5 3\n"
+        "0.5\n0.3\n0.7\n0.2\n0.9\n"
+        " third_02\n"
+        " 1 4 2\n"
+        "0.333333333333\n0.666666666667\n0.5\n0.5\n";
+#define PAD     4096
+
+/* prob_set_read of the bytes given, through a regular file */
+static int read_bytes(struct prob_set *set,
+                      const void *bytes,
+                      size_t len,
+                      size_t k);
+/* the binary file prob_set_write_bin makes of set, in a malloc'd buffer */
+static unsigned char *write_bin(const struct prob_set *set,
+                                int width,
+                                size_t *len);
+/* whether b holds the same problems as a, with by_size orders */
+static bool same_set(struct prob_set a,
+                     struct prob_set b,
+                     size_t first);
+/* reads a copy of bin, followed by PAD zero bytes, with entry k changed
+ * by edit given the copy's length, and prints whether it was rejected */
+static void check_edit(const unsigned char *bin,
+                       size_t len,
+                       size_t k,
+                       const char *what,
+                       void (*edit)(struct prob_bin_entry *, size_t));
+
+static void edit_far_doubles(struct prob_bin_entry *entry,
+                             size_t len) {
+        /* n * 8 is past the file, but n * 4 is not; by_size is all 0 */
+        entry->width = 8;
+        entry->by_size_at = (len - PAD + 7) & ~(size_t)7;
+        entry->inst_sz = (len - entry->by_size_at) / sizeof(uint32_t);
+        entry->sizes_at = 8 << 20;
+}
+static void edit_sizes_past_end(struct prob_bin_entry *entry,
+                                size_t len) {
+        entry->sizes_at = (len + 7) & ~(size_t)7;
+}
+static void edit_by_size_past_end(struct prob_bin_entry *entry,
+                                  size_t len) {
+        entry->by_size_at = (len & ~(size_t)3) - 4 * (entry->inst_sz - 1);
+}
+static void edit_huge(struct prob_bin_entry *entry,
+                      size_t len) {
+        entry->inst_sz = UINT64_MAX / 2;
+}
+static void edit_width(struct prob_bin_entry *entry,
+                       size_t len) {
+        entry->width = 3;
+}
+
+int main(int argc, char **argv) {
+        struct prob_set text;
+        if (read_bytes(&text, TEXT, sizeof(TEXT) - 1, SIZE_MAX) != 0) {
+                printf("text read failed\n");
+                return 1;
+        }
+        printf("text: %zu problems\n", text.num_problems);
+
+        const int widths[] = {0, 1, 2, 4, 8};
+        for (size_t w = 0; w < sizeof(widths) / sizeof(*widths); w++) {
+                size_t len;
+                unsigned char *bin = write_bin(&text, widths[w], &len);
+                const struct prob_bin_entry *entries = (const void *)(bin
+                        + sizeof(struct prob_bin_header));
+                struct prob_set set;
+                const int ret = read_bytes(&set, bin, len, SIZE_MAX);
+                printf("width %d: read %d, widths", widths[w], ret);
+                for (size_t i = 0; i < text.num_problems; i++) {
+                        printf(" %u", entries[i].width);
+                }
+                printf(", same %d, bounds", (ret == 0)
+                       && same_set(text, set, 0));
+                for (size_t i = 0; (ret == 0) && (i < set.num_problems);
+                     i++) {
+                        printf(" %zu", set.problems[i].lower_bound);
+                }
+                putchar('\n');
+                if (ret == 0) {
+                        prob_set_destroy(set);
+                }
+                free(bin);
+        }
+
+        size_t len;
+        unsigned char *bin = write_bin(&text, 0, &len);
+        struct prob_set one;
+        int ret = read_bytes(&one, bin, len, 1);
+        printf("problem 1 alone: read %d, same %d\n", ret,
+               (ret == 0) && same_set(text, one, 1));
+        if (ret == 0) {
+                prob_set_destroy(one);
+        }
+        ret = read_bytes(&one, bin, len, 3);
+        printf("problem 3 alone: read %d\n", ret);
+
+        const struct prob_bin_entry *entries = (const void *)(bin
+                + sizeof(struct prob_bin_header));
+        const size_t last_at = entries[2].by_size_at;
+        struct prob_set set;
+        printf("truncated directory: read %d\n",
+               read_bytes(&set, bin, sizeof(struct prob_bin_header)
+                                     + sizeof(*entries), SIZE_MAX));
+        printf("truncated sizes: read %d\n",
+               read_bytes(&set, bin, last_at + 4, SIZE_MAX));
+        ret = read_bytes(&set, bin, last_at + 4, 1);
+        printf("truncated, problem 1 alone: read %d\n", ret);
+        if (ret == 0) {
+                prob_set_destroy(set);
+        }
+        check_edit(bin, len, 0, "doubles far past the end",
+                   edit_far_doubles);
+        check_edit(bin, len, 1, "sizes past the end", edit_sizes_past_end);
+        check_edit(bin, len, 1, "by_size past the end",
+                   edit_by_size_past_end);
+        check_edit(bin, len, 2, "huge size", edit_huge);
+        check_edit(bin, len, 0, "bad width", edit_width);
+
+        unsigned char *copy = malloc(len);
+        if (copy == NULL) {
+                abort();
+        }
+        memcpy(copy, bin, len);
+        uint32_t bad_item = entries[1].inst_sz;
+        memcpy(copy + entries[1].by_size_at, &bad_item, sizeof(bad_item));
+        printf("by_size item out of range: read %d\n",
+               read_bytes(&set, copy, len, SIZE_MAX));
+        free(copy);
+        free(bin);
+        prob_set_destroy(text);
+        return 0;
+}
+
+static int read_bytes(struct prob_set *set,
+                      const void *bytes,
+                      size_t len,
+                      size_t k) {
+        FILE *file = tmpfile();
+        if ((file == NULL) || (fwrite(bytes, 1, len, file) != len)
+            || (fflush(file) != 0)) {
+                abort();
+        }
+        const int fd = fileno(file);
+        lseek(fd, 0, SEEK_SET);
+        const int ret = (k == SIZE_MAX) ? prob_set_read(set, fd)
+                                        : prob_set_read_one(set, fd, k);
+        fclose(file);
+        return ret;
+}
+static unsigned char *write_bin(const struct prob_set *set,
+                                int width,
+                                size_t *len) {
+        FILE *file = tmpfile();
+        if ((file == NULL) || (prob_set_write_bin(set, file, width) != 0)
+            || (fflush(file) != 0)) {
+                abort();
+        }
+        *len = ftell(file);
+        unsigned char *bin = malloc(*len);
+        if (bin == NULL) {
+                abort();
+        }
+        rewind(file);
+        if (fread(bin, 1, *len, file) != *len) {
+                abort();
+        }
+        fclose(file);
+        return bin;
+}
+static bool same_set(struct prob_set a,
+                     struct prob_set b,
+                     size_t first) {
+        for (size_t i = 0; i < b.num_problems; i++) {
+                const struct problem *pa = &a.problems[first + i];
+                const struct problem *pb = &b.problems[i];
+                if ((strcmp(pa->name, pb->name) != 0)
+                    || (pa->bin_cap != pb->bin_cap)
+                    || (pa->inst_sz != pb->inst_sz)
+                    || (pa->optimal_num_bins != pb->optimal_num_bins)
+                    || (pb->by_size == NULL)) {
+                        return false;
+                }
+                for (size_t j = 0; j < pb->inst_sz; j++) {
+                        if (pa->prob_inst[j] != pb->prob_inst[j]) {
+                                return false;
+                        }
+                        /* by decreasing size */
+                        if ((j > 0)
+                            && (pb->prob_inst[pb->by_size[j - 1]]
+                                < pb->prob_inst[pb->by_size[j]])) {
+                                return false;
+                        }
+                }
+        }
+        return true;
+}
+static void check_edit(const unsigned char *bin,
+                       size_t len,
+                       size_t k,
+                       const char *what,
+                       void (*edit)(struct prob_bin_entry *, size_t)) {
+        unsigned char *copy = calloc(len + PAD, 1);
+        if (copy == NULL) {
+                abort();
+        }
+        memcpy(copy, bin, len);
+        struct prob_bin_entry *entries = (void *)(copy
+                + sizeof(struct prob_bin_header));
+        edit(&entries[k], len + PAD);
+        struct prob_set set;
+        const int ret = read_bytes(&set, copy, len + PAD, SIZE_MAX);
+        printf("%s: read %d\n", what, ret);
+        if (ret == 0) {
+                prob_set_destroy(set);
+        }
+        free(copy);
+}
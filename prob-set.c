@@ -0,0 +1,592 @@
+#include "prob-set.h"
+#include "int-inst.h"
+#include "lower-bound.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <float.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* the text left to parse */
+struct cursor {
+        const char *pos;
+        const char *end;
+};
+
+static const struct prob_set EMPTY_SET = {.num_problems = 0,
+                                          .problems = NULL,
+                                          .sizes = NULL,
+                                          .map = NULL,
+                                          .map_sz = 0};
+
+/* reads fd, mapped if possible, into a set of count problems from first
+ * on, or of all of them if count is SIZE_MAX */
+static int read_fd(struct prob_set *set,
+                   int fd,
+                   size_t first,
+                   size_t count);
+/* on success, keeps only count problems from first on, unless count is
+ * SIZE_MAX; -1 if there are not that many */
+static int keep_range(struct prob_set *set,
+                      int ret,
+                      size_t first,
+                      size_t count);
+static int parse(struct prob_set *set,
+                 struct cursor cur);
+/* the binary file in map, which set takes over on success */
+static int read_bin(struct prob_set *set,
+                    void *map,
+                    size_t map_sz,
+                    size_t first,
+                    size_t count);
+/* problem k of the binary file in map; sizes stored narrower than
+ * doubles are converted into sizes. false if its entry does not fit the
+ * file */
+static bool bin_problem(const unsigned char *map,
+                        size_t map_sz,
+                        size_t k,
+                        struct problem *prob,
+                        double *sizes);
+static bool is_space(char ch);
+static void skip_space(struct cursor *cur);
+/* copies a token of any non-space characters into name, cut short to
+ * fit */
+static bool parse_name(struct cursor *cur,
+                       char *name,
+                       size_t name_sz);
+static bool parse_size(struct cursor *cur,
+                       size_t *out);
+/* decimal numbers of at most 19 significant digits and a small exponent
+ * are converted exactly by one division; everything
+ * else goes to strtod, so the result always matches scanf's */
+static bool parse_double(struct cursor *cur,
+                         double *out);
+static bool parse_double_slow(struct cursor *cur,
+                              double *out);
+/* all of what remains to be read from fd, in a malloc'd buffer */
+static char *read_all(int fd,
+                      size_t *len);
+/* the narrowest of 1, 2 and 4 bytes that holds every size of ii, or 8 */
+static int int_width(const struct int_inst *ii);
+/* writes zeros up to the next multiple of 8 bytes */
+static bool write_pad(FILE *out,
+                      uint64_t *pos);
+
+int prob_set_read(struct prob_set *set,
+                  int fd) {
+        return read_fd(set, fd, 0, SIZE_MAX);
+}
+int prob_set_read_one(struct prob_set *set,
+                      int fd,
+                      size_t k) {
+        return read_fd(set, fd, k, 1);
+}
+void prob_set_destroy(struct prob_set set) {
+        free(set.problems);
+        free(set.sizes);
+        if (set.map != NULL) {
+                munmap(set.map, set.map_sz);
+        }
+}
+int prob_set_write_bin(const struct prob_set *set,
+                       FILE *out,
+                       int width) {
+        const size_t n = set->num_problems;
+        struct prob_bin_entry *entries = calloc(n, sizeof(*entries));
+        struct int_inst *iis = malloc(n * sizeof(*iis));
+        uint32_t **orders = calloc(n, sizeof(*orders));
+        if ((n > 0) && ((entries == NULL) || (iis == NULL)
+                        || (orders == NULL))) {
+                abort();
+        }
+        int ret = 0;
+        /* everything but the sizes and orders themselves, which follow
+         * the directory in problem order */
+        uint64_t pos = sizeof(struct prob_bin_header) + n * sizeof(*entries);
+        for (size_t i = 0; i < n; i++) {
+                const struct problem *prob = &set->problems[i];
+                struct prob_bin_entry *entry = &entries[i];
+                if (prob->inst_sz > UINT32_MAX) {
+                        ret = -1;
+                        goto exit;
+                }
+                orders[i] = malloc(prob->inst_sz * sizeof(*orders[i]));
+                if ((orders[i] == NULL) && (prob->inst_sz > 0)) {
+                        abort();
+                }
+                lower_bound_order(prob->prob_inst, prob->inst_sz, orders[i]);
+                memcpy(entry->name, prob->name, sizeof(entry->name));
+                entry->bin_cap = prob->bin_cap;
+                entry->inst_sz = prob->inst_sz;
+                entry->optimal_num_bins = prob->optimal_num_bins;
+                entry->width = 8;
+                entry->scale = 1;
+                if (int_inst_init(&iis[i], prob->prob_inst, prob->inst_sz,
+                                  prob->bin_cap)) {
+                        entry->lower_bound = lower_bound_best(&iis[i],
+                                                              orders[i]);
+                        const int narrowest = int_width(&iis[i]);
+                        if ((width == 0)
+                            || ((width >= narrowest) && (width < 8))) {
+                                entry->width = (width == 0) ? narrowest
+                                                            : width;
+                                entry->scale = iis[i].scale;
+                        }
+                        int_inst_destroy(iis[i]);
+                } else {
+                        entry->lower_bound = lower_bound_l1_double(
+                                prob->prob_inst, prob->inst_sz,
+                                prob->bin_cap);
+                }
+                pos = (pos + 7) & ~(uint64_t)7;
+                entry->sizes_at = pos;
+                pos += prob->inst_sz * entry->width;
+                pos = (pos + 7) & ~(uint64_t)7;
+                entry->by_size_at = pos;
+                pos += prob->inst_sz * sizeof(uint32_t);
+        }
+
+        struct prob_bin_header header = {.magic = PROB_BIN_MAGIC,
+                                         .version = PROB_BIN_VERSION,
+                                         .byte_order = PROB_BIN_BYTE_ORDER,
+                                         .num_problems = n};
+        if ((fwrite(&header, sizeof(header), 1, out) != 1)
+            || (fwrite(entries, sizeof(*entries), n, out) != n)) {
+                ret = -1;
+                goto exit;
+        }
+        pos = sizeof(header) + n * sizeof(*entries);
+        for (size_t i = 0; i < n; i++) {
+                const struct problem *prob = &set->problems[i];
+                const struct prob_bin_entry *entry = &entries[i];
+                if (!write_pad(out, &pos)) {
+                        ret = -1;
+                        goto exit;
+                }
+                for (size_t j = 0; j < prob->inst_sz; j++) {
+                        const double size = prob->prob_inst[j];
+                        /* exact, as int_inst_init checked */
+                        const uint32_t scaled = nearbyint(size
+                                                          * entry->scale);
+                        const uint8_t u8 = scaled;
+                        const uint16_t u16 = scaled;
+                        const void *src = (entry->width == 1) ? (void *)&u8
+                                          : (entry->width == 2)
+                                          ? (void *)&u16
+                                          : (entry->width == 4)
+                                          ? (void *)&scaled
+                                          : (void *)&size;
+                        if (fwrite(src, entry->width, 1, out) != 1) {
+                                ret = -1;
+                                goto exit;
+                        }
+                }
+                pos += prob->inst_sz * entry->width;
+                if (!write_pad(out, &pos)
+                    || (fwrite(orders[i], sizeof(*orders[i]), prob->inst_sz,
+                               out) != prob->inst_sz)) {
+                        ret = -1;
+                        goto exit;
+                }
+                pos += prob->inst_sz * sizeof(*orders[i]);
+        }
+exit:
+        for (size_t i = 0; i < n; i++) {
+                free(orders[i]);
+        }
+        free(orders);
+        free(iis);
+        free(entries);
+        return ret;
+}
+
+static int read_fd(struct prob_set *set,
+                   int fd,
+                   size_t first,
+                   size_t count) {
+        *set = EMPTY_SET;
+        struct stat st;
+        off_t off = lseek(fd, 0, SEEK_CUR);
+        if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (off >= 0)
+            && (st.st_size > off)) {
+                const size_t len = st.st_size;
+                const char *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd,
+                                       0);
+                if (map != MAP_FAILED) {
+                        if ((off == 0) && (len >= sizeof(PROB_BIN_MAGIC))
+                            && (memcmp(map, PROB_BIN_MAGIC,
+                                       sizeof(PROB_BIN_MAGIC)) == 0)) {
+                                return read_bin(set, (void *)map, len, first,
+                                                count);
+                        }
+                        madvise((void *)map, len, MADV_SEQUENTIAL);
+                        const int ret = parse(set, (struct cursor){
+                                .pos = map + off,
+                                .end = map + len});
+                        munmap((void *)map, len);
+                        return keep_range(set, ret, first, count);
+                }
+        }
+        size_t len;
+        char *buf = read_all(fd, &len);
+        if (buf == NULL) {
+                return -1;
+        }
+        /* binary files are only read mapped */
+        if ((len >= sizeof(PROB_BIN_MAGIC))
+            && (memcmp(buf, PROB_BIN_MAGIC, sizeof(PROB_BIN_MAGIC)) == 0)) {
+                free(buf);
+                return -1;
+        }
+        const int ret = parse(set, (struct cursor){.pos = buf,
+                                                   .end = buf + len});
+        free(buf);
+        return keep_range(set, ret, first, count);
+}
+static int keep_range(struct prob_set *set,
+                      int ret,
+                      size_t first,
+                      size_t count) {
+        if ((ret != 0) || (count == SIZE_MAX)) {
+                return ret;
+        }
+        if ((first > set->num_problems)
+            || (count > set->num_problems - first)) {
+                prob_set_destroy(*set);
+                *set = EMPTY_SET;
+                return -1;
+        }
+        memmove(set->problems, set->problems + first,
+                count * sizeof(*set->problems));
+        set->num_problems = count;
+        return 0;
+}
+
+static int parse(struct prob_set *set,
+                 struct cursor cur) {
+        *set = EMPTY_SET;
+        size_t num_problems;
+        /* every problem takes more than a byte, which also bounds the
+         * allocations below */
+        if (!parse_size(&cur, &num_problems)
+            || (num_problems > (size_t)(cur.end - cur.pos))) {
+                return -1;
+        }
+        struct problem *problems = malloc(num_problems * sizeof(*problems));
+        if ((problems == NULL) && (num_problems > 0)) {
+                abort();
+        }
+        double *sizes = NULL;
+        size_t num_sizes = 0;
+        size_t cap = 0;
+        for (size_t i = 0; i < num_problems; i++) {
+                struct problem *prob = &problems[i];
+                prob->lower_bound = 0;
+                prob->by_size = NULL;
+                if (!parse_name(&cur, prob->name, sizeof(prob->name))
+                    || !parse_double(&cur, &prob->bin_cap)
+                    || !parse_size(&cur, &prob->inst_sz)
+                    || !parse_size(&cur, &prob->optimal_num_bins)
+                    || (prob->inst_sz > (size_t)(cur.end - cur.pos))) {
+                        goto malformed;
+                }
+                if (num_sizes + prob->inst_sz > cap) {
+                        cap = (2 * cap > num_sizes + prob->inst_sz)
+                              ? 2 * cap : num_sizes + prob->inst_sz;
+                        sizes = realloc(sizes, cap * sizeof(*sizes));
+                        if (sizes == NULL) {
+                                abort();
+                        }
+                }
+                for (size_t j = 0; j < prob->inst_sz; j++) {
+                        if (!parse_double(&cur, &sizes[num_sizes++])) {
+                                goto malformed;
+                        }
+                }
+        }
+        /* the block has stopped moving; point every problem into it */
+        size_t start = 0;
+        for (size_t i = 0; i < num_problems; i++) {
+                problems[i].prob_inst = (sizes != NULL) ? sizes + start
+                                                        : NULL;
+                start += problems[i].inst_sz;
+        }
+        set->num_problems = num_problems;
+        set->problems = problems;
+        set->sizes = sizes;
+        return 0;
+malformed:
+        free(problems);
+        free(sizes);
+        return -1;
+}
+static bool is_space(char ch) {
+        return (ch == ' ') || (ch == '\n') || (ch == '\t') || (ch == '\r')
+               || (ch == '\v') || (ch == '\f');
+}
+static void skip_space(struct cursor *cur) {
+        while ((cur->pos < cur->end) && is_space(*cur->pos)) {
+                cur->pos++;
+        }
+}
+static bool parse_name(struct cursor *cur,
+                       char *name,
+                       size_t name_sz) {
+        skip_space(cur);
+        const char *start = cur->pos;
+        while ((cur->pos < cur->end) && !is_space(*cur->pos)) {
+                cur->pos++;
+        }
+        size_t len = cur->pos - start;
+        if (len >= name_sz) {
+                len = name_sz - 1;
+        }
+        memcpy(name, start, len);
+        name[len] = '\0';
+        return cur->pos != start;
+}
+static bool parse_size(struct cursor *cur,
+                       size_t *out) {
+        skip_space(cur);
+        const char *p = cur->pos;
+        size_t val = 0;
+        while ((p < cur->end) && (*p >= '0') && (*p <= '9')) {
+                const size_t digit = *p - '0';
+                if (val > (SIZE_MAX - digit) / 10) {
+                        return false;
+                }
+                val = val * 10 + digit;
+                p++;
+        }
+        if ((p == cur->pos) || ((p < cur->end) && !is_space(*p))) {
+                return false;
+        }
+        cur->pos = p;
+        *out = val;
+        return true;
+}
+static bool parse_double(struct cursor *cur,
+                         double *out) {
+        static const double pow10[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+                1e21, 1e22};
+        skip_space(cur);
+        const char *p = cur->pos;
+        const bool is_neg = (p < cur->end) && (*p == '-');
+        if ((p < cur->end) && ((*p == '-') || (*p == '+'))) {
+                p++;
+        }
+        uint64_t mant = 0;
+        int num_digits = 0;
+        int num_sig_digits = 0;
+        int exp10 = 0;
+        bool is_frac = false;
+        for (; p < cur->end; p++) {
+                if ((*p == '.') && !is_frac) {
+                        is_frac = true;
+                        continue;
+                }
+                if ((*p < '0') || (*p > '9')) {
+                        break;
+                }
+                num_digits++;
+                if ((mant != 0) || (*p != '0')) {
+                        num_sig_digits++;
+                }
+                mant = mant * 10 + (*p - '0');
+                exp10 -= is_frac;
+        }
+        /* an exponent, hex, inf, nan or too many digits */
+        if ((num_digits == 0) || (num_sig_digits > 19)
+            || ((p < cur->end) && !is_space(*p))
+            || (mant > ((uint64_t)1 << 53)) || (exp10 < -22)) {
+                return parse_double_slow(cur, out);
+        }
+        /* both operands are exact, so the one rounding is correct */
+        const double val = (double)mant / pow10[-exp10];
+        *out = (is_neg) ? -val : val;
+        cur->pos = p;
+        return true;
+}
+static bool parse_double_slow(struct cursor *cur,
+                              double *out) {
+        char buf[128];
+        const char *start = cur->pos;
+        const char *p = start;
+        while ((p < cur->end) && !is_space(*p)) {
+                p++;
+        }
+        const size_t len = p - start;
+        if ((len == 0) || (len >= sizeof(buf))) {
+                return false;
+        }
+        memcpy(buf, start, len);
+        buf[len] = '\0';
+        char *end;
+        *out = strtod(buf, &end);
+        if (end != buf + len) {
+                return false;
+        }
+        cur->pos = p;
+        return true;
+}
+static char *read_all(int fd,
+                      size_t *len) {
+        size_t cap = 1 << 16;
+        size_t num = 0;
+        char *buf = malloc(cap);
+        if (buf == NULL) {
+                abort();
+        }
+        while (true) {
+                if (num == cap) {
+                        cap *= 2;
+                        buf = realloc(buf, cap);
+                        if (buf == NULL) {
+                                abort();
+                        }
+                }
+                const ssize_t got = read(fd, buf + num, cap - num);
+                if (got > 0) {
+                        num += got;
+                } else if (got == 0) {
+                        break;
+                } else if (errno != EINTR) {
+                        free(buf);
+                        return NULL;
+                }
+        }
+        *len = num;
+        return buf;
+}
+static int read_bin(struct prob_set *set,
+                    void *map,
+                    size_t map_sz,
+                    size_t first,
+                    size_t count) {
+        const struct prob_bin_header *header = map;
+        const size_t entry_sz = sizeof(struct prob_bin_entry);
+        if ((map_sz < sizeof(*header))
+            || (header->version != PROB_BIN_VERSION)
+            || (header->byte_order != PROB_BIN_BYTE_ORDER)
+            || (header->num_problems
+                > (map_sz - sizeof(*header)) / entry_sz)) {
+                goto malformed;
+        }
+        if (count == SIZE_MAX) {
+                count = header->num_problems;
+        }
+        if ((first > header->num_problems)
+            || (count > header->num_problems - first)) {
+                goto malformed;
+        }
+        struct problem *problems = malloc(count * sizeof(*problems));
+        if ((problems == NULL) && (count > 0)) {
+                abort();
+        }
+        /* room for the sizes not stored as doubles */
+        const struct prob_bin_entry *entries = (const void *)(header + 1);
+        size_t num_sizes = 0;
+        for (size_t i = first; i < first + count; i++) {
+                if ((entries[i].width != 8)
+                    && (entries[i].inst_sz <= map_sz)) {
+                        num_sizes += entries[i].inst_sz;
+                }
+        }
+        double *sizes = malloc(num_sizes * sizeof(*sizes));
+        if ((sizes == NULL) && (num_sizes > 0)) {
+                abort();
+        }
+        double *next = sizes;
+        for (size_t i = 0; i < count; i++) {
+                if (!bin_problem(map, map_sz, first + i, &problems[i],
+                                 next)) {
+                        free(problems);
+                        free(sizes);
+                        goto malformed;
+                }
+                if (entries[first + i].width != 8) {
+                        next += problems[i].inst_sz;
+                }
+        }
+        *set = (struct prob_set){.num_problems = count,
+                                 .problems = problems,
+                                 .sizes = sizes,
+                                 .map = map,
+                                 .map_sz = map_sz};
+        return 0;
+malformed:
+        munmap(map, map_sz);
+        return -1;
+}
+static bool bin_problem(const unsigned char *map,
+                        size_t map_sz,
+                        size_t k,
+                        struct problem *prob,
+                        double *sizes) {
+        const struct prob_bin_entry *entry = (const struct prob_bin_entry *)
+                (map + sizeof(struct prob_bin_header)) + k;
+        const uint64_t n = entry->inst_sz;
+        const uint32_t width = entry->width;
+        if (((width != 1) && (width != 2) && (width != 4) && (width != 8))
+            || (entry->scale == 0)
+            || (entry->sizes_at % 8 != 0) || (entry->by_size_at % 4 != 0)
+            || (entry->sizes_at > map_sz)
+            || (n > (map_sz - entry->sizes_at) / width)
+            || (entry->by_size_at > map_sz)
+            || (n > (map_sz - entry->by_size_at) / sizeof(uint32_t))) {
+                return false;
+        }
+        const uint32_t *by_size = (const uint32_t *)(map
+                                                     + entry->by_size_at);
+        for (uint64_t i = 0; i < n; i++) {
+                if (by_size[i] >= n) {
+                        return false;
+                }
+        }
+        memcpy(prob->name, entry->name, sizeof(prob->name));
+        prob->name[sizeof(prob->name) - 1] = '\0';
+        prob->bin_cap = entry->bin_cap;
+        prob->inst_sz = n;
+        prob->optimal_num_bins = entry->optimal_num_bins;
+        prob->lower_bound = entry->lower_bound;
+        prob->by_size = by_size;
+        const unsigned char *src = map + entry->sizes_at;
+        if (width == 8) {
+                prob->prob_inst = (const double *)src;
+                return true;
+        }
+        const double scale = entry->scale;
+        for (uint64_t i = 0; i < n; i++) {
+                const uint32_t scaled = (width == 1)
+                                        ? src[i]
+                                        : (width == 2)
+                                        ? ((const uint16_t *)src)[i]
+                                        : ((const uint32_t *)src)[i];
+                sizes[i] = scaled / scale;
+        }
+        prob->prob_inst = sizes;
+        return true;
+}
+static int int_width(const struct int_inst *ii) {
+        uint32_t max = 0;
+        for (size_t i = 0; i < ii->inst_sz; i++) {
+                if (ii->sizes[i] > max) {
+                        max = ii->sizes[i];
+                }
+        }
+        return (max <= UINT8_MAX) ? 1 : (max <= UINT16_MAX) ? 2 : 4;
+}
+static bool write_pad(FILE *out,
+                      uint64_t *pos) {
+        static const char zeros[8] = {0};
+        const size_t pad = (8 - (*pos % 8)) % 8;
+        *pos += pad;
+        return fwrite(zeros, 1, pad, out) == pad;
+}
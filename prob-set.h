@@ -0,0 +1,88 @@
+#ifndef PROB_SET_H
+#define PROB_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* one problem of an OR-Library bin-packing file */
+struct problem {
+        char name[32];
+        double bin_cap;
+        size_t inst_sz;
+        size_t optimal_num_bins;
+        /* points into the set's storage */
+        const double *prob_inst;
+        /* what a binary file precomputed: a lower bound on the bins, and
+         * the items by decreasing size (see lower-bound.h); 0 and NULL
+         * when read from text */
+        size_t lower_bound;
+        const uint32_t *by_size;
+};
+/* every problem of one input file */
+struct prob_set {
+        size_t num_problems;
+        struct problem *problems;
+        /* one block holding the sizes of every problem in order, or of
+         * those not stored as doubles in a binary file */
+        double *sizes;
+        /* a binary file stays mapped while its problems point into it */
+        void *map;
+        size_t map_sz;
+};
+
+/* Parses a whole OR-Library file: the number of problems, then per
+ * problem an identifier, the bin capacity, the number of items, the
+ * known optimum and the item sizes. A regular file is mapped and parsed
+ * in place; anything else, such as a pipe, is read in through a growing
+ * buffer first. A binary file (below) is recognized by its magic and
+ * read instead. Returns 0, or -1 on a read error or malformed input with
+ * set left empty. */
+int prob_set_read(struct prob_set *set,
+                  int fd);
+/* prob_set_read keeping only problem k, which becomes problem 0; a
+ * mapped binary file is not looked at beyond its directory and problem
+ * k. -1 also if there is no problem k */
+int prob_set_read_one(struct prob_set *set,
+                      int fd,
+                      size_t k);
+void prob_set_destroy(struct prob_set set);
+
+/* Binary problem files, in host byte order, laid out as
+ *   struct prob_bin_header
+ *   num_problems struct prob_bin_entry
+ * followed by each problem's sizes and by_size index, at the offsets
+ * given in its entry, each 8-byte aligned. A size of width 1, 2 or 4
+ * bytes is an unsigned integer that divides by scale to the exact
+ * double; width 8 stores the double itself. */
+#define PROB_BIN_MAGIC          "BPPROBS"
+#define PROB_BIN_VERSION        1
+#define PROB_BIN_BYTE_ORDER     0x01020304
+struct prob_bin_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t num_problems;
+};
+struct prob_bin_entry {
+        char name[32];
+        double bin_cap;
+        uint64_t inst_sz;
+        uint64_t optimal_num_bins;
+        uint64_t lower_bound;
+        uint64_t sizes_at;
+        uint64_t by_size_at;
+        uint32_t width;
+        uint32_t scale;
+};
+/* Writes set as a binary file, computing each problem's lower bound and
+ * by_size order. Width 0 stores each problem's sizes in the narrowest
+ * exact width; 1, 2 or 4 use that width where it is wide enough. Sizes
+ * with no exact integer form (see int-inst.h), or asked for at width 8,
+ * are stored as doubles. Returns 0, or -1 on a write error or a problem
+ * of more than UINT32_MAX items */
+int prob_set_write_bin(const struct prob_set *set,
+                       FILE *out,
+                       int width);
+
+#endif /* !PROB_SET_H */
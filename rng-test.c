@@ -0,0 +1,43 @@
+#include "rng.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+#define DRAWS   60000
+#define BOUND   6
+
+int main(int argc, char **argv) {
+        rng_seed(42);
+        printf("seed 42:");
+        for (int i = 0; i < 4; i++) {
+                printf(" %016" PRIx64, rng_next());
+        }
+        putchar('\n');
+
+        rng_seed(42);
+        printf("reseeded:");
+        for (int i = 0; i < 4; i++) {
+                printf(" %016" PRIx64, rng_next());
+        }
+        putchar('\n');
+
+        printf("streams of seed 42:");
+        for (uint64_t key = 0; key < 4; key++) {
+                rng_seed_key(42, key);
+                printf(" %" PRIu64, rng_bounded(1000));
+        }
+        putchar('\n');
+
+        int hist[BOUND] = {0};
+        double sum = 0;
+        for (int i = 0; i < DRAWS; i++) {
+                hist[rng_bounded(BOUND)]++;
+                sum += rng_unit();
+        }
+        printf("bounded(%d) histogram over %d draws:", BOUND, DRAWS);
+        for (int i = 0; i < BOUND; i++) {
+                printf(" %d", hist[i]);
+        }
+        putchar('\n');
+        printf("unit mean: %lf\n", sum / DRAWS);
+        return 0;
+}
@@ -0,0 +1,67 @@
+#include "rng.h"
+#include <assert.h>
+
+static __thread uint64_t state[4] = {0x9e3779b97f4a7c15,
+                                     0xbf58476d1ce4e5b9,
+                                     0x94d049bb133111eb,
+                                     0x2545f4914f6cdd1d};
+
+static uint64_t splitmix64(uint64_t *x);
+static inline uint64_t rotl(uint64_t x,
+                            int k);
+
+void rng_seed(uint64_t seed) {
+        for (int i = 0; i < 4; i++) {
+                state[i] = splitmix64(&seed);
+        }
+}
+void rng_seed_key(uint64_t seed,
+                  uint64_t key) {
+        rng_seed(rng_mix(seed, key));
+}
+uint64_t rng_mix(uint64_t a,
+                 uint64_t b) {
+        uint64_t x = b;
+        x = a ^ splitmix64(&x);
+        return splitmix64(&x);
+}
+
+uint64_t rng_next(void) {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+}
+/* Lemire's multiply-shift with rejection of the biased low products */
+uint64_t rng_bounded(uint64_t bound) {
+        assert(bound > 0);
+        unsigned __int128 m = (unsigned __int128)rng_next() * bound;
+        uint64_t low = m;
+        if (low < bound) {
+                const uint64_t threshold = -bound % bound;
+                while (low < threshold) {
+                        m = (unsigned __int128)rng_next() * bound;
+                        low = m;
+                }
+        }
+        return m >> 64;
+}
+double rng_unit(void) {
+        return (rng_next() >> 11) * 0x1.0p-53;
+}
+
+static uint64_t splitmix64(uint64_t *x) {
+        uint64_t z = (*x += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+}
+static inline uint64_t rotl(uint64_t x,
+                            int k) {
+        return (x << k) | (x >> (64 - k));
+}
@@ -0,0 +1,26 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* Per-thread xoshiro256** generator. Every thread starts from the same
+ * fixed state until it is seeded; nothing is shared between threads. */
+
+/** Seeds the calling thread's generator */
+void rng_seed(uint64_t seed);
+/** Seeds the calling thread's generator with an independent stream picked
+ * by key, e.g. an element index, so results do not depend on which thread
+ * draws them */
+void rng_seed_key(uint64_t seed,
+                  uint64_t key);
+/** Hashes two words into one; for building keys */
+uint64_t rng_mix(uint64_t a,
+                 uint64_t b);
+
+uint64_t rng_next(void);
+/** Unbiased draw from [0, bound); bound must be non-zero */
+uint64_t rng_bounded(uint64_t bound);
+/** Uniform draw from [0, 1) */
+double rng_unit(void);
+
+#endif /* !RNG_H */